@@ -0,0 +1,127 @@
+/**
+ * macfand - hipuranyhou - 16.10.2026
+ *
+ * Daemon for controlling fans on Linux systems using
+ * applesmc and coretemp.
+ *
+ * https://github.com/Hipuranyhou/macfand
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/helper.h"
+
+// Microbenchmark of sysfs_to_int() against getline() and str_to_int() pipeline it replaced
+
+#define BENCH_ITERS  2000000
+#define BENCH_ROUNDS 5
+
+/**
+ * @brief Values as read from temperature, fan and pwm attributes.
+ */
+static const char *const vals[] = {
+    "45000\n", "61000\n", "100000\n", "2000\n", "5927\n", "255\n", "0\n", "-1\n"
+};
+
+#define BENCH_VALS ((int)(sizeof(vals) / sizeof(vals[0])))
+
+/**
+ * @brief Parses value using getline() and str_to_int().
+ * Parses value the way attributes were read before sysfs_to_int() (stream, getline(), removal of trailing
+ * newline and str_to_int()).
+ * @param[in]  buf  Buffer holding read value.
+ * @param[in]  len  Number of bytes in buffer.
+ * @param[out] dest Address of destination.
+ * @return int 0 on error, 1 on success.
+ */
+static int bench_getline(const char *const buf, const size_t len, int *const dest);
+
+/**
+ * @brief Parses value using sysfs_to_int().
+ * Parses value the way attributes are read now.
+ * @param[in]  buf  Buffer holding read value.
+ * @param[in]  len  Number of bytes in buffer.
+ * @param[out] dest Address of destination.
+ * @return int 0 on error, 1 on success.
+ */
+static int bench_sysfs(const char *const buf, const size_t len, int *const dest);
+
+/**
+ * @brief Runs benchmark of given parser.
+ * Runs BENCH_ROUNDS rounds of BENCH_ITERS parses over all values and prints fastest round in ns/parse.
+ * @param[in] name  Name of parser.
+ * @param[in] parse Parser to be measured.
+ * @return int 0 on error, 1 on success.
+ */
+static int bench_run(const char *const name, int (*parse)(const char *const, const size_t, int *const));
+
+
+static int bench_getline(const char *const buf, const size_t len, int *const dest) {
+    FILE    *file    = NULL;
+    char    *line    = NULL;
+    size_t  line_len = 0;
+    ssize_t get_ret  = 0;
+    int     ret      = 0;
+
+    file = fmemopen((void*)buf, len, "r");
+    if (!file)
+        return 0;
+
+    get_ret = getline(&line, &line_len, file);
+    fclose(file);
+    if (get_ret > 0 && line[get_ret-1] == '\n')
+        line[get_ret-1] = '\0';
+
+    ret = (get_ret > 0 && str_to_int(line, dest, 10, NULL) == 1);
+    free(line);
+
+    return ret;
+}
+
+
+static int bench_sysfs(const char *const buf, const size_t len, int *const dest) {
+    return sysfs_to_int(buf, len, dest);
+}
+
+
+static int bench_run(const char *const name, int (*parse)(const char *const, const size_t, int *const)) {
+    size_t    lens[BENCH_VALS];
+    long long start = 0;
+    long long best  = -1;
+    long long sum   = 0;
+    int       val   = 0;
+    int       i     = 0;
+    int       j     = 0;
+
+    for (i = 0; i < BENCH_VALS; i++)
+        lens[i] = strlen(vals[i]);
+
+    for (j = 0; j < BENCH_ROUNDS; j++) {
+        start = time_mono_us();
+        for (i = 0; i < BENCH_ITERS; i++) {
+            // str_to_int() does not take sign, so "-1" fails there and is still timed
+            parse(vals[i % BENCH_VALS], lens[i % BENCH_VALS], &val);
+            sum += val;
+        }
+        start = time_mono_us() - start;
+        if (best < 0 || start < best)
+            best = start;
+    }
+
+    if (best < 0)
+        return 0;
+
+    printf("%-22s %8.1f ns/parse (checksum %lld)\n", name, best * 1000.0 / BENCH_ITERS, sum);
+    return 1;
+}
+
+
+int main(void) {
+    if (!bench_run("getline + str_to_int", bench_getline) || !bench_run("sysfs_to_int", bench_sysfs))
+        return EXIT_FAILURE;
+
+    return EXIT_SUCCESS;
+}
@@ -11,11 +11,14 @@
 #include <errno.h>
 #include <string.h>
 #include <ctype.h>
+#include <limits.h>
 
 #include "config.h"
 #include "settings.h"
 #include "logger.h"
 #include "helper.h"
+#include "control.h"
+#include "fan.h"
 
 
 /**
@@ -27,6 +30,15 @@
  */
 static int conf_assign_int(const char *key, const int val);
 
+/**
+ * @brief Assigns value of given double setting.
+ * Assigns value of given double setting.
+ * @param[in] key Name of setting to be assigned.
+ * @param[in] val Double to be assigned.
+ * @return int 0 on error, 1 on success.
+ */
+static int conf_assign_dbl(const char *key, const double val);
+
 /**
  * @brief Assigns value of given string setting.
  * Assigns value of given string setting.
@@ -72,8 +84,15 @@ static int conf_assign_int(const char *key, const int val) {
         if (!set_set_int(SET_TEMP_HIGH, val))
             return 0;
     } else if (strcmp(key, "time_poll") == 0) {
+        // Poll time is kept in milliseconds
+        if (!set_set_int(SET_TIME_POLL, (val > INT_MAX / 1000) ? INT_MAX : val * 1000))
+            return 0;
+    } else if (strcmp(key, "time_poll_ms") == 0) {
         if (!set_set_int(SET_TIME_POLL, val))
             return 0;
+    } else if (strcmp(key, "time_poll_idle_ms") == 0) {
+        if (!set_set_int(SET_TIME_POLL_IDLE, val))
+            return 0;
     } else if (strcmp(key, "daemon") == 0) {
         if (!set_set_int(SET_DAEMON, val))
             return 0;
@@ -83,6 +102,78 @@ static int conf_assign_int(const char *key, const int val) {
     } else if (strcmp(key, "widget") == 0) {
         if (!set_set_int(SET_WIDGET, val))
             return 0;
+    } else if (strcmp(key, "io_uring") == 0) {
+        if (!set_set_int(SET_IO_URING, val))
+            return 0;
+    } else if (strcmp(key, "pid_target") == 0) {
+        if (!set_set_int(SET_PID_TARGET, val))
+            return 0;
+    } else if (strcmp(key, "mpc_ceiling") == 0) {
+        if (!set_set_int(SET_MPC_CEILING, val))
+            return 0;
+    } else if (strcmp(key, "mpc_horizon") == 0) {
+        if (!set_set_int(SET_MPC_HORIZON, val))
+            return 0;
+    } else if (strcmp(key, "feed_power_low") == 0) {
+        if (!set_set_int(SET_FEED_POWER_LOW, val))
+            return 0;
+    } else if (strcmp(key, "feed_power_high") == 0) {
+        if (!set_set_int(SET_FEED_POWER_HIGH, val))
+            return 0;
+    } else if (strcmp(key, "feed_load_low") == 0) {
+        if (!set_set_int(SET_FEED_LOAD_LOW, val))
+            return 0;
+    } else if (strcmp(key, "feed_load_high") == 0) {
+        if (!set_set_int(SET_FEED_LOAD_HIGH, val))
+            return 0;
+    } else if (strcmp(key, "psi_stall_ms") == 0) {
+        if (!set_set_int(SET_PSI_STALL, val))
+            return 0;
+    } else if (strcmp(key, "psi_window_ms") == 0) {
+        if (!set_set_int(SET_PSI_WINDOW, val))
+            return 0;
+    } else if (strcmp(key, "fan_deadband") == 0) {
+        if (!set_set_int(SET_FAN_DEADBAND, val))
+            return 0;
+    } else if (strcmp(key, "fan_dwell_ms") == 0) {
+        if (!set_set_int(SET_FAN_DWELL, val))
+            return 0;
+    } else if (strcmp(key, "fan_readback") == 0) {
+        if (!set_set_int(SET_FAN_READBACK, val))
+            return 0;
+    } else if (strcmp(key, "fan_slew") == 0) {
+        if (!set_set_int(SET_FAN_SLEW, val))
+            return 0;
+    } else if (strcmp(key, "pwm_min") == 0) {
+        if (!set_set_int(SET_PWM_MIN, val))
+            return 0;
+    } else if (strcmp(key, "fan_settle_ms") == 0) {
+        if (!set_set_int(SET_FAN_SETTLE, val))
+            return 0;
+    } else if (strcmp(key, "fan_tolerance") == 0) {
+        if (!set_set_int(SET_FAN_TOLERANCE, val))
+            return 0;
+    } else
+        return conf_assign_dbl(key, val);
+
+    return 1;
+}
+
+
+static int conf_assign_dbl(const char *key, const double val) {
+
+    if (strcmp(key, "pid_kp") == 0) {
+        if (!set_set_dbl(SET_PID_KP, val))
+            return 0;
+    } else if (strcmp(key, "pid_ki") == 0) {
+        if (!set_set_dbl(SET_PID_KI, val))
+            return 0;
+    } else if (strcmp(key, "pid_kd") == 0) {
+        if (!set_set_dbl(SET_PID_KD, val))
+            return 0;
+    } else if (strcmp(key, "pid_tau") == 0) {
+        if (!set_set_dbl(SET_PID_TAU, val))
+            return 0;
     } else
         return 0;
 
@@ -91,6 +182,7 @@ static int conf_assign_int(const char *key, const int val) {
 
 
 static int conf_assign_str(const char *key, const char *val) {
+    double val_dbl = 0;
 
     // Log type
     if (strcmp(key, "log_type") == 0) {
@@ -107,12 +199,65 @@ static int conf_assign_str(const char *key, const char *val) {
         } else
             return 0;
 
+    // Control mode
+    } else if (strcmp(key, "ctrl_mode") == 0) {
+
+        if (strcmp(val, "curve") == 0) {
+            if (!set_set_int(SET_CTRL_MODE, CTRL_M_CURVE))
+                return 0;
+        } else if (strcmp(val, "pid") == 0) {
+            if (!set_set_int(SET_CTRL_MODE, CTRL_M_PID))
+                return 0;
+        } else if (strcmp(val, "mpc") == 0) {
+            if (!set_set_int(SET_CTRL_MODE, CTRL_M_MPC))
+                return 0;
+        } else
+            return 0;
+
+    // Fan backend
+    } else if (strcmp(key, "fan_backend") == 0) {
+
+        if (strcmp(val, "auto") == 0) {
+            if (!set_set_int(SET_FAN_BACKEND, FAN_B_AUTO))
+                return 0;
+        } else if (strcmp(val, "applesmc") == 0) {
+            if (!set_set_int(SET_FAN_BACKEND, FAN_B_SMC))
+                return 0;
+        } else if (strcmp(val, "pwm") == 0) {
+            if (!set_set_int(SET_FAN_BACKEND, FAN_B_PWM))
+                return 0;
+        } else
+            return 0;
+
     } else if (strcmp(key, "log_file_path") == 0) {
         if (!set_set_str(SET_LOG_FILE_PATH, val))
             return 0;
     } else if (strcmp(key, "widget_file_path") == 0) {
         if (!set_set_str(SET_WIDGET_FILE_PATH, val))
             return 0;
+    } else if (strcmp(key, "sensors") == 0) {
+        if (!set_set_str(SET_SENSORS, val))
+            return 0;
+    } else if (strcmp(key, "status_file_path") == 0) {
+        if (!set_set_str(SET_STATUS_FILE_PATH, val))
+            return 0;
+    } else if (strcmp(key, "zones") == 0) {
+        if (!set_set_str(SET_ZONES, val))
+            return 0;
+    } else if (strcmp(key, "curve") == 0) {
+        if (!set_set_str(SET_CURVE, val))
+            return 0;
+    } else if (strcmp(key, "curve_fall") == 0) {
+        if (!set_set_str(SET_CURVE_FALL, val))
+            return 0;
+    } else if (strcmp(key, "sysfs_root") == 0) {
+        if (!set_set_str(SET_SYSFS_ROOT, val))
+            return 0;
+    } else if (strcmp(key, "pwm_chips") == 0) {
+        if (!set_set_str(SET_PWM_CHIPS, val))
+            return 0;
+    } else if (str_to_dbl(val, &val_dbl)) {
+        return conf_assign_dbl(key, val_dbl);
     } else
         return 0;
 
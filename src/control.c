@@ -8,9 +8,12 @@
  */
 
 #include <stdio.h>
+#include <string.h>
+#include <math.h>
 #include <time.h>
 #include <syslog.h>
 #include <signal.h>
+#include <poll.h>
 
 #include "control.h"
 #include "helper.h"
@@ -21,151 +24,916 @@
 #include "monitor.h"
 #include "widget.h"
 #include "daemonize.h"
+#include "sweep.h"
+#include "status.h"
+#include "zone.h"
+#include "curve.h"
+#include "timer.h"
+#include "event.h"
+#include "uevent.h"
+#include "power.h"
+
+#define CTRL_RATE_RISE    250
+#define CTRL_THR_HOLD     30000000LL
+
+#define CTRL_W_SIG  0
+#define CTRL_W_TMR  1
+#define CTRL_W_ALRM 2
+#define CTRL_W_PSI  3
+#define CTRL_W_TICK 4
+
+#define CTRL_TMR_POLL 0
+#define CTRL_TMR_TICK 1
+#define CTRL_SLEW_TICK 100
+
+#define CTRL_MPC_LAMBDA   0.995
+#define CTRL_MPC_COV_INIT 10.0
+#define CTRL_MPC_COV_MAX  1000.0
+#define CTRL_MPC_LEARN    30
+#define CTRL_MPC_TAU      4.0
+#define CTRL_MPC_DITH     0.1
+#define CTRL_MPC_DITH_T   16000000LL
 
 /**
  * @brief Reloads settings from configuration file.
- * Reloads settings from configuration file, check its validity and reloads logger.
- * @return int 0 on error, 1 on success.
+ * Resets settings to defaults (with command line overrides), reloads them from configuration file and checks their
+ * validity. Changed settings are logged and only state derived from them is rebuilt (logger, thermal zones, fan
+ * curves and control temperatures of zones). Settings which can change only after restart keep previous values.
+ * New state is prepared before it replaces current one, so when anything fails, previous settings and state are kept.
+ * @param[in]     mons  Pointer to table of temperature monitors.
+ * @param[in,out] fans  Pointer to head of generic linked list of system fans.
+ * @param[in,out] zones Pointer to pointer to table of thermal zones (replaced when zones changed).
+ * @return int 0 if previous settings were kept, 1 if new settings were applied.
+ */
+static int ctrl_rld_conf(const t_mons *const mons, t_node *fans, t_zones **zones);
+
+/**
+ * @brief Applies reloaded settings to zone.
+ * Updates control temperatures of given zone from settings, moves model of model-predictive controller by
+ * given change of settings->mpc_ceiling (model is relative to it) and resets controllers when control mode
+ * changed, so they do not continue from stale samples.
+ * @param[in,out] zone  Pointer to zone.
+ * @param[in]     shift Change of settings->mpc_ceiling in degrees.
+ * @param[in]     reset Boolean if controllers should be reset.
  */
-static int ctrl_rld_conf(void);
+static void ctrl_rld_zone(t_zone *const zone, const int shift, const int reset);
 
 /**
  * @brief Calculates fan target speed.
- * Calculates new fan speed based on temperatures stored in temps which will be fan->min if current temperature is 
- * under settings->temp_low, fan->max if current temperature is over settings->temp_max, or one of
- * (fan->min + fan->step * steps) and (fan->max - fan->step * steps) if fans need to cool more or less, respectively.
- * @param[in,out] temps Pointer to struct holding control temperature values.
- * @param[in]     fan   Pointer to current adjusted fan.
+ * Calculates new fan speed for given zone. In curve mode uses current temperature of zone and speed lookup
+ * table of fan compiled by crv_load(), which is fan->min under settings->temp_low. In PID mode scales output
+ * of PID controller of zone and in MPC mode output of model-predictive controller of zone (until its model
+ * is usable curve is used) to range between fan->min and fan->max. Speed is fan->max over settings->temp_max
+ * in all modes.
+ * @param[in]     zone Pointer to zone holding control temperature values and controllers.
+ * @param[in,out] fan  Pointer to current adjusted fan.
  */
-static void ctrl_calc_spd(struct ctrl_temps *const temps, t_fan *const fan);
+static void ctrl_calc_spd(const t_zone *const zone, t_fan *const fan);
+
+/**
+ * @brief Updates PID controller of zone.
+ * Updates PID controller of given zone with its current temperature sampled at given time. Error is difference
+ * between current temperature and settings->pid_target, integral is frozen while output is saturated (anti-windup)
+ * and derivative is taken from temperature (not error) and low-pass filtered with time constant settings->pid_tau.
+ * Real elapsed time since previous sample is used.
+ * @param[in,out] zone Pointer to zone.
+ * @param[in]     now  Time of sample in microseconds (time_mono_us()).
+ */
+static void ctrl_calc_pid(t_zone *const zone, const long long now);
+
+/**
+ * @brief Updates model-predictive controller of zone.
+ * Updates model of given zone with its current (low-pass filtered) temperature and mean measured speed of its fans
+ * sampled at given time using recursive least squares with forgetting (covariance is bounded, so it does not blow
+ * up while fans run at constant speed). Small square wave dither is added to fan speed, so effect of fans can be
+ * told apart from effect of temperature. Once model is usable (enough samples, fans cool and zone does not heat itself), output
+ * is the lowest fan speed for which temperature forecast at end of settings->mpc_horizon stays under
+ * settings->mpc_ceiling and time to settings->temp_max at current fan speed is estimated.
+ * @param[in,out] zone Pointer to zone.
+ * @param[in]     fans Pointer to head of generic linked list of system fans.
+ * @param[in]     now  Time of sample in microseconds (time_mono_us()).
+ */
+static void ctrl_calc_mpc(t_zone *const zone, const t_node *fans, const long long now);
+
+/**
+ * @brief Updates model of zone.
+ * Updates model of model-predictive controller with one sample of recursive least squares.
+ * @param[in,out] mpc Pointer to model-predictive controller.
+ * @param[in]     phi Regressors of sample (1, u and x of previous sample).
+ * @param[in]     y   Measured change of temperature in °C / s.
+ */
+static void ctrl_fit_mpc(struct ctrl_mpc *const mpc, const double phi[3], const double y);
+
+/**
+ * @brief Calculates fan target speed from all its zones.
+ * Calculates target speed of given fan using ctrl_calc_spd() for every zone which drives it and keeps
+ * the highest one. Feed-forward output is floor of target speed, so fans ramp up as soon as power draw
+ * rises, before temperature follows.
+ * @param[in]     zones Pointer to table of thermal zones.
+ * @param[in,out] fan   Pointer to current adjusted fan.
+ * @param[in]     feed  Feed-forward output (fraction of fan speed range).
+ */
+static void ctrl_calc_zones(const t_zones *const zones, t_fan *const fan, const double feed);
+
+/**
+ * @brief Compensates faulted fans.
+ * Raises target speed of every fan which reaches its commanded speed, when other fans of its zone stall or are
+ * underspeed (see fan_track()). Part of speed range missed by faulted fans of zone is shared by its healthy fans,
+ * fan driven by more zones is raised by the highest share.
+ * @param[in]     zones Pointer to table of thermal zones.
+ * @param[in,out] fans  Pointer to head of generic linked list of system fans.
+ */
+static void ctrl_calc_comp(const t_zones *const zones, t_node *fans);
 
 /**
  * @brief Adjusts temperatures in control.
- * Sets temp_previous to temp_current, updates temp_current using monitors_get_temp() and calculates temp_delta
- * based on these two updated values.
- * @param[in,out] temps Pointer to struct holding control temperature values.
- * @param[in]     mons  Pointer to head of generic linked list of temperature monitors.
+ * Sets temp_previous to temp_current, updates temp_current using zone_get_temp() from temperatures read by
+ * last sweep and calculates rate of change (per second) based on these two updated values and real time elapsed
+ * between them.
+ * @param[in,out] zone Pointer to zone holding control temperature values.
+ * @param[in]     mons Pointer to table of temperature monitors.
+ * @param[in]     now  Time of sample in microseconds (time_mono_us()).
  */
-static void ctrl_set_temps(struct ctrl_temps *const temps, t_node *mons);
+static void ctrl_set_temps(t_zone *const zone, const t_mons *const mons, const long long now);
 
+/**
+ * @brief Calculates poll time of next control cycle.
+ * Calculates poll time of next control cycle. Without settings->time_poll_idle it is always settings->time_poll.
+ * Otherwise it is settings->time_poll while temperature of any zone is over settings->temp_low or rises quickly
+ * (or any alarm is raised or CPU throttles) and doubles every cycle up to settings->time_poll_idle when all zones
+ * are idle and cool.
+ * @param[in] zones Pointer to table of thermal zones.
+ * @param[in] mons  Pointer to table of temperature monitors.
+ * @param[in] ms    Poll time of current control cycle in milliseconds.
+ * @param[in] now   Time of current control cycle in microseconds (time_mono_us()).
+ * @return int poll time of next control cycle in milliseconds.
+ */
+static int ctrl_calc_poll(const t_zones *const zones, const t_mons *const mons, const int ms, const long long now);
 
-volatile sig_atomic_t term_flag = 0;
-volatile sig_atomic_t rld_flag = 0;
+/**
+ * @brief Checks whether CPU throttles.
+ * Checks whether any CPU throttle counter rose during last CTRL_THR_HOLD microseconds.
+ * @param[in] mons Pointer to table of temperature monitors.
+ * @param[in] now  Current time in microseconds (time_mono_us()).
+ * @return int 0 if CPU does not throttle, 1 otherwise.
+ */
+static int ctrl_throttled(const t_mons *const mons, const long long now);
+
+/**
+ * @brief Slews and sets speed of all fans.
+ * Moves speed of every fan towards its target speed using fan_slew_spd() and sets it. While any fan is ramping,
+ * given slew timer ticks every CTRL_SLEW_TICK milliseconds (continuing its deadlines when it fired), otherwise
+ * it is stopped, so there are no extra wake ups at steady state.
+ * @param[in,out] fans  Pointer to head of generic linked list of system fans.
+ * @param[in,out] tick  Pointer to slew timer.
+ * @param[in]     now   Current time in microseconds (time_mono_us()).
+ * @param[in]     fired Whether slew timer fired.
+ * @return int 0 on error, 1 on success.
+ */
+static int ctrl_slew_fans(t_node *fans, t_tmr *const tick, const long long now, const int fired);
 
+/**
+ * @brief Prepares event loop.
+ * Prepares event loop with control loop timer, slew timer, alarms of monitors, configuration file (when used), kernel
+ * uevents and CPU pressure trigger (when used) as its event sources. Alarm, uevents or pressure trigger
+ * which can not be watched are skipped.
+ * @param[in] mons Pointer to table of temperature monitors.
+ * @param[in] tmr  Pointer to control loop timer.
+ * @param[in] tick Pointer to slew timer.
+ * @return t_evt* NULL on error, pointer to event loop otherwise (has to be freed by evt_free()).
+ */
+static t_evt *ctrl_init_evt(const t_mons *const mons, const t_tmr *const tmr, const t_tmr *const tick);
+
+/**
+ * @brief Waits for next control cycle.
+ * Waits for events of event loop and handles them. Catched signals set their flags, change of configuration
+ * file sets reload flag, uevents are handled by ctrl_hotplug() and signaled alarms are read, so control cycle
+ * which follows immediately sees them. Crossed CPU pressure trigger starts control cycle immediately too.
+ * @param[in]     evt  Pointer to event loop.
+ * @param[in,out] mons Pointer to table of temperature monitors.
+ * @param[in,out] fans Pointer to head of generic linked list of system fans.
+ * @return int CTRL_W_SIG if only signals or configuration changes were handled (or on error), CTRL_W_TMR if
+ * deadline of control loop timer passed, CTRL_W_PSI if CPU pressure trigger was crossed, CTRL_W_ALRM if alarm
+ * was signaled, CTRL_W_TICK if only slew timer fired.
+ */
+static int ctrl_wait(t_evt *const evt, t_mons *const mons, t_node *fans);
 
-static int ctrl_rld_conf(void) {
+/**
+ * @brief Handles pending uevents.
+ * Reads all pending kernel uevents. Removed hwmon chip detaches its monitors, added hwmon chip attaches its
+ * monitors again and starts watching their alarms. Added fan device (applesmc or hwmon chip with pwm outputs)
+ * recovers its fans. Monitors and fans of other devices are not touched.
+ * @param[in]     evt  Pointer to event loop.
+ * @param[in,out] mons Pointer to table of temperature monitors.
+ * @param[in,out] fans Pointer to head of generic linked list of system fans.
+ */
+static void ctrl_hotplug(t_evt *const evt, t_mons *const mons, t_node *fans);
 
-    if (!conf_load(set_get_str(SET_CONFIG_FILE_PATH))) {
-        log_log(LOG_L_ERROR, "Unable to load configuration file");
+/**
+ * @brief Registers CPU pressure trigger.
+ * Registers CPU pressure trigger of event loop from settings->psi_stall and settings->psi_window (kept when they
+ * did not change, removed when psi_stall is 0).
+ * @param[in,out] evt Pointer to event loop.
+ */
+static void ctrl_init_psi(t_evt *const evt);
+
+
+// Set from signals read by event loop
+static int term_flag = 0;
+static int rld_flag = 0;
+static int dump_flag = 0;
+
+
+static int ctrl_rld_conf(const t_mons *const mons, t_node *fans, t_zones **zones) {
+    static const int rst[] = {SET_DAEMON, SET_IO_URING, SET_SENSORS, SET_FAN_BACKEND, SET_SYSFS_ROOT, SET_PWM_CHIPS,
+                              SET_PWM_MIN};
+    t_zones *rld_zones = NULL;
+    int     ceil_old   = set_get_int(SET_MPC_CEILING);
+    int     chg_log    = 0;
+    int     chg_zones  = 0;
+    int     chg_crv    = 0;
+    int     chg_mode   = 0;
+    int     chg_rst    = 0;
+    int     ok         = 1;
+    int     i          = 0;
+
+    if (!set_get_str(SET_CONFIG_FILE_PATH)) {
+        log_log(LOG_L_INFO, "%s", "No configuration file to reload");
         return 0;
     }
 
-    if (!set_check()) {
-        log_log(LOG_L_ERROR, "Settings are invalid");
+    if (!set_snap_save()) {
+        log_log(LOG_L_ERROR, "%s", "Unable to save current settings");
         return 0;
     }
 
-    if (!log_set_type(set_get_int(SET_LOG_TYPE), set_get_str(SET_LOG_FILE_PATH))) {
-        log_log(LOG_L_ERROR, "Unable to set logger to configured mode");
+    // Settings removed from configuration file return to defaults, snapshot decides what changed
+    if (!set_reset() || !conf_load(set_get_str(SET_CONFIG_FILE_PATH)) || !set_check()) {
+        log_log(LOG_L_WARN, "%s", "Configuration file is invalid, keeping previous settings");
+        set_snap_restore();
         return 0;
     }
 
+    if (set_snap_log() == 0) {
+        log_log(LOG_L_INFO, "%s", "Configuration file reloaded, no setting changed");
+        set_snap_free();
+        return 1;
+    }
+
+    // Running monitors, fans and power readers keep using previous values (hotplug, reattach)
+    for (i = 0; i < (int)(sizeof(rst) / sizeof(rst[0])); i++) {
+        if (!set_snap_changed(rst[i]))
+            continue;
+        chg_rst = 1;
+        if (!set_snap_keep(rst[i])) {
+            log_log(LOG_L_ERROR, "%s", "Unable to keep previous settings");
+            set_snap_restore();
+            return 0;
+        }
+    }
+    if (chg_rst)
+        log_log(LOG_L_WARN, "%s", "Changes of daemon, io_uring, sensors, fan_backend, sysfs_root, pwm_chips and "
+                "pwm_min are applied only after restart");
+
+    chg_log = (set_snap_changed(SET_LOG_TYPE) || set_snap_changed(SET_LOG_FILE_PATH));
+    chg_zones = set_snap_changed(SET_ZONES);
+    chg_crv = (set_snap_changed(SET_TEMP_LOW) || set_snap_changed(SET_TEMP_HIGH) || set_snap_changed(SET_TEMP_MAX) ||
+               set_snap_changed(SET_CURVE) || set_snap_changed(SET_CURVE_FALL));
+    chg_mode = set_snap_changed(SET_CTRL_MODE);
+
+    // Prepare everything which can fail before current state is touched
+    if (chg_log)
+        ok = log_set_type(set_get_int(SET_LOG_TYPE), set_get_str(SET_LOG_FILE_PATH));
+    if (ok && chg_zones) {
+        rld_zones = zones_load(mons, fans);
+        ok = (rld_zones != NULL);
+    }
+    if (ok && chg_crv)
+        ok = crvs_load(fans);
+
+    if (!ok) {
+        zones_free(rld_zones);
+        set_snap_restore();
+        if (chg_log)
+            log_set_type(set_get_int(SET_LOG_TYPE), set_get_str(SET_LOG_FILE_PATH));
+        if (chg_crv)
+            crvs_load(fans);
+        log_log(LOG_L_WARN, "%s", "Unable to apply reloaded settings, keeping previous ones");
+        return 0;
+    }
+
+    // New zones already hold new settings, current ones keep state of their controllers
+    if (rld_zones) {
+        zones_free(*zones);
+        *zones = rld_zones;
+    } else {
+        for (i = 0; i < (*zones)->cnt; i++)
+            ctrl_rld_zone(&((*zones)->zone[i]), set_get_int(SET_MPC_CEILING) - ceil_old, chg_mode);
+    }
+
+    set_snap_free();
+    log_log(LOG_L_INFO, "%s", "Configuration file reloaded");
     return 1;
 }
 
 
-static void ctrl_calc_spd(struct ctrl_temps *const temps, t_fan *const fan) {
-    int steps = 0;
+static void ctrl_rld_zone(t_zone *const zone, const int shift, const int reset) {
+    zone->temps.high = set_get_int(SET_TEMP_HIGH);
+    zone->temps.low = set_get_int(SET_TEMP_LOW);
+    zone->temps.max = set_get_int(SET_TEMP_MAX);
 
-    fan->spd.tgt = fan->spd.real;
+    zone->mpc.theta[0] += zone->mpc.theta[2] * shift;
+    zone->mpc.temp -= shift;
 
-    // Extremes
-    if (temps->real >= temps->max) {
-        fan->spd.tgt = fan->spd.max;
+    if (!reset)
         return;
+
+    zone->pid.integ = 0;
+    zone->pid.deriv = 0;
+    zone->pid.time = 0;
+    zone->pid.out = 0;
+    zone->mpc.time = 0;
+}
+
+
+static void ctrl_calc_spd(const t_zone *const zone, t_fan *const fan) {
+    double out = 0;
+
+    switch (set_get_int(SET_CTRL_MODE)) {
+        case CTRL_M_PID:
+            out = zone->pid.out;
+            break;
+        case CTRL_M_MPC:
+            if (zone->mpc.ok)
+                out = zone->mpc.out;
+            else if (fan->spd.max > fan->spd.min)
+                out = (double)(crv_get_spd(fan, zone->temps.real) - fan->spd.min) / (fan->spd.max - fan->spd.min);
+            out += zone->mpc.dith;
+            out = (out < 0) ? 0 : ((out > 1) ? 1 : out);
+            break;
+        default:
+            fan->spd.tgt = crv_get_spd(fan, zone->temps.real);
+            return;
     }
 
-    if (temps->real <= temps->low) {
-        fan->spd.tgt = fan->spd.min;
+    if (zone->temps.real >= zone->temps.max * 1000) {
+        fan->spd.tgt = fan->spd.max;
+        fan->slew.ovr = 1;
         return;
     }
 
-    // Set higher or lower speed
-    if (temps->dlt > 0 && temps->real > temps->high) {
-        steps = (temps->real - temps->high) * (temps->real - temps->high + 1) / 2;
-        fan->spd.tgt = max(fan->spd.tgt, (fan->spd.min + (steps * fan->spd.step)));
-        return;
+    fan->spd.tgt = fan->spd.min + (fan->spd.max - fan->spd.min) * out + 0.5;
+}
+
+
+static void ctrl_calc_pid(t_zone *const zone, const long long now) {
+    struct ctrl_pid *pid   = &(zone->pid);
+    double          kp     = set_get_dbl(SET_PID_KP);
+    double          ki     = set_get_dbl(SET_PID_KI);
+    double          kd     = set_get_dbl(SET_PID_KD);
+    double          tau    = set_get_dbl(SET_PID_TAU);
+    double          err    = (zone->temps.real - set_get_int(SET_PID_TARGET) * 1000) / 1000.0;
+    double          integ  = pid->integ;
+    double          dt     = 0;
+    double          out    = 0;
+
+    // First sample has no previous one
+    if (pid->time > 0 && now > pid->time) {
+        dt = (now - pid->time) / 1000000.0;
+        integ += err * dt;
+        pid->deriv += (dt / (tau + dt)) * (zone->temps.rate / 1000.0 - pid->deriv);
+    }
+    pid->time = now;
+
+    // Integrate only while output is not pushed further into saturation
+    out = kp * err + ki * integ + kd * pid->deriv;
+    if ((out < 1 || err < 0) && (out > 0 || err > 0))
+        pid->integ = integ;
+
+    out = kp * err + ki * pid->integ + kd * pid->deriv;
+    pid->out = (out < 0) ? 0 : ((out > 1) ? 1 : out);
+}
+
+
+static void ctrl_fit_mpc(struct ctrl_mpc *const mpc, const double phi[3], const double y) {
+    double cov_phi[3] = {0, 0, 0};
+    double gain[3]    = {0, 0, 0};
+    double den        = CTRL_MPC_LAMBDA;
+    double err        = y;
+    double tr         = 0;
+    int    i          = 0;
+    int    j          = 0;
+
+    for (i = 0; i < 3; i++) {
+        for (j = 0; j < 3; j++)
+            cov_phi[i] += mpc->cov[i][j] * phi[j];
+        den += phi[i] * cov_phi[i];
+        err -= mpc->theta[i] * phi[i];
+    }
+
+    for (i = 0; i < 3; i++) {
+        gain[i] = cov_phi[i] / den;
+        mpc->theta[i] += gain[i] * err;
+    }
+
+    for (i = 0; i < 3; i++) {
+        for (j = 0; j < 3; j++)
+            mpc->cov[i][j] = (mpc->cov[i][j] - gain[i] * cov_phi[j]) / CTRL_MPC_LAMBDA;
+        tr += mpc->cov[i][i];
     }
 
-    if (temps->dlt < 0 && temps->real > temps->low) {
-        steps = (temps->low - temps->real) * (temps->low - temps->real + 1) / 2;
-        fan->spd.tgt = min(fan->spd.tgt, (fan->spd.max - (steps * fan->spd.step)));
+    // Forgetting without excitation (fans at constant speed) would blow covariance up
+    if (tr > CTRL_MPC_COV_MAX)
+        for (i = 0; i < 3; i++)
+            for (j = 0; j < 3; j++)
+                mpc->cov[i][j] *= CTRL_MPC_COV_MAX / tr;
+}
+
+
+static void ctrl_calc_mpc(t_zone *const zone, const t_node *fans, const long long now) {
+    struct ctrl_mpc *mpc  = &(zone->mpc);
+    const t_fan     *fan  = NULL;
+    double          lim   = set_get_int(SET_MPC_CEILING);
+    double          hor   = set_get_int(SET_MPC_HORIZON);
+    double          x     = zone->temps.real / 1000.0 - lim;
+    double          x_max = zone->temps.max - lim;
+    double          u     = 0;
+    double          phi[3] = {0, 0, 0};
+    double          dt    = 0;
+    double          gain  = 0;
+    double          drv   = 0;
+    double          eq    = 0;
+    int             cnt   = 0;
+    int             ok    = mpc->ok;
+
+    // Commanded speed is used, real one is read back only every few cycles
+    for (; fans; fans = fans->next) {
+        fan = fans->data;
+        if (!zone_has_fan(zone, fan->id) || fan->spd.max <= fan->spd.min)
+            continue;
+        u += (double)(fan_get_spd(fan) - fan->spd.min) / (fan->spd.max - fan->spd.min);
+        cnt++;
+    }
+    u = (cnt) ? u / cnt : 0;
+    u = (u < 0) ? 0 : ((u > 1) ? 1 : u);
+
+    // Model is fitted to low-pass filtered temperature, raw one is too coarse (usually whole degrees) to derive
+    if (mpc->time == 0) {
+        // Model learned before control mode was switched is kept
+        if (mpc->cnt == 0)
+            mpc->cov[0][0] = mpc->cov[1][1] = mpc->cov[2][2] = CTRL_MPC_COV_INIT;
+        mpc->temp = x;
+    } else if (now > mpc->time) {
+        dt = (now - mpc->time) / 1000000.0;
+        phi[0] = 1;
+        phi[1] = mpc->spd;
+        phi[2] = mpc->temp;
+        mpc->temp += (dt / (CTRL_MPC_TAU + dt)) * (x - mpc->temp);
+        ctrl_fit_mpc(mpc, phi, (mpc->temp - phi[2]) / dt);
+        if (mpc->cnt < CTRL_MPC_LEARN)
+            mpc->cnt++;
+    }
+    mpc->spd = u;
+    mpc->time = now;
+
+    // Fan speed has to keep changing independently of temperature, otherwise effect of fans can not be told apart
+    mpc->dith = ((now / CTRL_MPC_DITH_T) & 1) ? CTRL_MPC_DITH : -CTRL_MPC_DITH;
+
+    // Usable only when fans cool zone and zone does not heat itself up
+    mpc->ok = (mpc->cnt >= CTRL_MPC_LEARN && mpc->theta[1] < 0 && mpc->theta[2] <= 0);
+    if (mpc->ok != ok)
+        log_log(LOG_L_DEBUG, "Thermal model of zone %s is %s", zone->name, (mpc->ok) ? "usable" : "not usable, using curve");
+    if (!mpc->ok) {
+        mpc->ttm = -1;
         return;
     }
+
+    // x(t) = x * gain + (theta[0] + theta[1] * u) * drv, lowest u keeping x(hor) <= 0 (forecast is monotonic)
+    gain = exp(mpc->theta[2] * hor);
+    drv = (mpc->theta[2] < 0) ? (1 - gain) / -mpc->theta[2] : hor;
+    mpc->out = -(x * gain / drv + mpc->theta[0]) / mpc->theta[1];
+    mpc->out = (mpc->out < 0) ? 0 : ((mpc->out > 1) ? 1 : mpc->out);
+
+    // Time to temp_max at current fan speed
+    drv = mpc->theta[0] + mpc->theta[1] * u;
+    if (x >= x_max) {
+        mpc->ttm = 0;
+    } else if (mpc->theta[2] < 0) {
+        eq = drv / -mpc->theta[2];
+        mpc->ttm = (eq > x_max) ? log((x_max - eq) / (x - eq)) / mpc->theta[2] : -1;
+    } else {
+        mpc->ttm = (drv > 0) ? (x_max - x) / drv : -1;
+    }
+
+    if (mpc->ttm >= 0)
+        log_log(LOG_L_DEBUG, "Zone %s reaches temp_max in %.0f s at current fan speed", zone->name, mpc->ttm);
+}
+
+
+static void ctrl_calc_zones(const t_zones *const zones, t_fan *const fan, const double feed) {
+    int tgt = fan->spd.min + (fan->spd.max - fan->spd.min) * feed + 0.5;
+    int i   = 0;
+
+    fan->slew.ovr = 0;
+    for (i = 0; i < zones->cnt; i++) {
+        if (!zone_has_fan(&(zones->zone[i]), fan->id))
+            continue;
+        ctrl_calc_spd(&(zones->zone[i]), fan);
+        tgt = max(tgt, fan->spd.tgt);
+    }
+
+    fan->spd.tgt = tgt;
+}
+
+
+static void ctrl_calc_comp(const t_zones *const zones, t_node *fans) {
+    const t_node *head  = fans;
+    const t_node *other = NULL;
+    t_fan        *fan   = NULL;
+    const t_fan  *oth   = NULL;
+    double       miss   = 0;
+    double       share  = 0;
+    int          ok     = 0;
+    int          i      = 0;
+
+    for (; fans; fans = fans->next) {
+        fan = fans->data;
+        if (fan->trk.state != FAN_S_OK)
+            continue;
+
+        share = 0;
+        for (i = 0; i < zones->cnt; i++) {
+            if (!zone_has_fan(&(zones->zone[i]), fan->id))
+                continue;
+
+            miss = 0;
+            ok = 0;
+            for (other = head; other; other = other->next) {
+                oth = other->data;
+                if (!zone_has_fan(&(zones->zone[i]), oth->id))
+                    continue;
+                if (oth->trk.state == FAN_S_OK)
+                    ok++;
+                else
+                    miss += oth->trk.miss;
+            }
+
+            if (miss / ok > share)
+                share = miss / ok;
+        }
+
+        if (share > 0)
+            fan->spd.tgt = min(fan->spd.max, fan->spd.tgt + (fan->spd.max - fan->spd.min) * share + 0.5);
+    }
 }
 
 
-static void ctrl_set_temps(struct ctrl_temps *const temps, t_node *mons) {
+static void ctrl_set_temps(t_zone *const zone, const t_mons *const mons, const long long now) {
+    struct ctrl_temps *temps = &(zone->temps);
+
     temps->prev = temps->real;
-    temps->real = mons_read_temp(mons);
-    temps->dlt = temps->real - temps->prev;
-}
-
-
-int ctrl_start(t_node *mons, t_node *fans) {
-    struct ctrl_temps temps = {
-        .prev = 0,
-        .real = 0,
-        .dlt = 0,
-        .high = set_get_int(SET_TEMP_HIGH),
-        .low = set_get_int(SET_TEMP_LOW),
-        .max = set_get_int(SET_TEMP_MAX),
-    };
-    struct timespec ts = {
-        .tv_sec = set_get_int(SET_TIME_POLL),
-        .tv_nsec = 0
-    };
-    t_fan  *fan       = NULL;
-    t_node *fans_head = fans;
-    
+    temps->real = zone_get_temp(zone, mons);
+
+    // First sample has no previous one
+    if (temps->time > 0 && now > temps->time)
+        temps->rate = (temps->real - temps->prev) * 1000000LL / (now - temps->time);
+    else
+        temps->rate = 0;
+    temps->time = now;
+}
+
+
+static int ctrl_calc_poll(const t_zones *const zones, const t_mons *const mons, const int ms, const long long now) {
+    int fast = set_get_int(SET_TIME_POLL);
+    int idle = set_get_int(SET_TIME_POLL_IDLE);
+    int i    = 0;
+
+    if (idle <= fast || mons->alrm.act > 0 || ctrl_throttled(mons, now))
+        return fast;
+
+    for (i = 0; i < zones->cnt; i++)
+        if (zones->zone[i].temps.real >= zones->zone[i].temps.low * 1000 ||
+            zones->zone[i].temps.rate >= CTRL_RATE_RISE)
+            return fast;
+
+    // Back off slowly, so short idle moments do not make us miss next load
+    return (ms > idle / 2) ? idle : ms * 2;
+}
+
+
+static int ctrl_throttled(const t_mons *const mons, const long long now) {
+    return (mons->thr.hit > 0 && now - mons->thr.hit < CTRL_THR_HOLD);
+}
+
+
+static int ctrl_slew_fans(t_node *fans, t_tmr *const tick, const long long now, const int fired) {
+    t_fan *fan  = NULL;
+    int   ramp  = 0;
+
+    for (; fans; fans = fans->next) {
+        fan = fans->data;
+        ramp |= fan_slew_spd(fan, now);
+        if (!fan_write_spd(fan))
+            log_log(LOG_L_DEBUG, "Unable to set speed of fan %d", fan->id);
+    }
+
+    if (!ramp)
+        return (tick->per == 0 || tmr_stop(tick));
+
+    // Control cycle during ramp leaves running tick alone
+    if (fired || tick->per == 0)
+        return tmr_arm(tick, CTRL_SLEW_TICK, 1);
+
+    return 1;
+}
+
+
+static t_evt *ctrl_init_evt(const t_mons *const mons, const t_tmr *const tmr, const t_tmr *const tick) {
+    t_evt *evt = NULL;
+    int   i    = 0;
+
+    evt = evt_init();
+    if (!evt)
+        return NULL;
+
+    if (!evt_add(evt, tmr->fd, EPOLLIN, EVT_T_TMR, CTRL_TMR_POLL) ||
+        !evt_add(evt, tick->fd, EPOLLIN, EVT_T_TMR, CTRL_TMR_TICK)) {
+        evt_free(evt);
+        return NULL;
+    }
+
+    for (i = 0; i < mons->alrm.cnt; i++)
+        if (mons->alrm.fds[i].fd >= 0 && !evt_add(evt, mons->alrm.fds[i].fd, EPOLLPRI, EVT_T_ALRM, i))
+            log_log(LOG_L_WARN, "Unable to watch alarm of monitor %d", mons->alrm.mon[i] + 1);
+
+    if (set_get_str(SET_CONFIG_FILE_PATH) && !evt_watch_conf(evt, set_get_str(SET_CONFIG_FILE_PATH)))
+        log_log(LOG_L_WARN, "%s", "Unable to watch configuration file, send SIGHUP to reload it");
+
+    if (!evt_watch_uev(evt))
+        log_log(LOG_L_WARN, "%s", "Unable to watch uevents, removed sensors and fans are not rediscovered");
+
+    ctrl_init_psi(evt);
+
+    return evt;
+}
+
+
+static void ctrl_init_psi(t_evt *const evt) {
+    if (!evt_watch_psi(evt, set_get_int(SET_PSI_STALL), set_get_int(SET_PSI_WINDOW)))
+        log_log(LOG_L_WARN, "%s", "Unable to register CPU pressure trigger, load onset is seen only by polling");
+}
+
+
+static void ctrl_hotplug(t_evt *const evt, t_mons *const mons, t_node *fans) {
+    struct uev uev;
+    int        hw = 0;
+    int        i  = 0;
+
+    while (uev_read(evt->uev, &uev)) {
+        if (uev.act == UEV_A_OTHER)
+            continue;
+
+        hw = uev_get_hw(&uev);
+        if (hw >= 0 && uev.act == UEV_A_REMOVE)
+            mons_hw_del(mons, hw);
+        else if (hw >= 0 && mons_hw_add(mons, hw) > 0) {
+            for (i = 0; i < mons->alrm.cnt; i++)
+                if (mons->alrm.fds[i].fd >= 0 && mons->info[mons->alrm.mon[i]].id.hw == hw &&
+                    !evt_add(evt, mons->alrm.fds[i].fd, EPOLLPRI, EVT_T_ALRM, i))
+                    log_log(LOG_L_WARN, "Unable to watch alarm of monitor %d", mons->alrm.mon[i] + 1);
+        }
+
+        // Fans live on applesmc platform device or on hwmon chip, depending on backend
+        if (fans_has_dev(fans, uev.dev)) {
+            if (uev.act == UEV_A_REMOVE)
+                log_log(LOG_L_WARN, "Fan device %s was removed", uev.dev);
+            else if (fans_recover(fans, uev.dev))
+                log_log(LOG_L_INFO, "Fan device %s appeared, fans are back in manual mode", uev.dev);
+        }
+    }
+}
+
+
+static int ctrl_wait(t_evt *const evt, t_mons *const mons, t_node *fans) {
+    int wake = CTRL_W_SIG;
+    int alrm = 0;
+    int psi  = 0;
+    int tick = 0;
+    int sig  = 0;
+    int i    = 0;
+
+    if (evt_wait(evt) < 0)
+        return CTRL_W_SIG;
+
+    for (i = 0; i < evt->cnt; i++) {
+        switch (evt_get_type(evt, i)) {
+            case EVT_T_SIG:
+                while ((sig = evt_read_sig(evt)) > 0) {
+                    if (sig == SIGHUP)
+                        rld_flag = sig;
+                    else if (sig == SIGUSR1)
+                        dump_flag = sig;
+                    else
+                        term_flag = sig;
+                }
+                break;
+            case EVT_T_CONF:
+                if (evt_read_conf(evt)) {
+                    log_log(LOG_L_INFO, "%s", "Configuration file changed");
+                    rld_flag = SIGHUP;
+                }
+                break;
+            case EVT_T_UEV:
+                ctrl_hotplug(evt, mons, fans);
+                break;
+            case EVT_T_TMR:
+                if (evt_get_idx(evt, i) == CTRL_TMR_TICK)
+                    tick = 1;
+                else
+                    wake = CTRL_W_TMR;
+                break;
+            case EVT_T_ALRM:
+                mons->alrm.fds[evt_get_idx(evt, i)].revents = POLLPRI;
+                alrm = 1;
+                break;
+            case EVT_T_PSI:
+                psi = 1;
+                break;
+        }
+    }
+
+    if (alrm && mons_read_alarm(mons, 0) > 0 && wake != CTRL_W_TMR)
+        log_log(LOG_L_DEBUG, "Temperature alarm signaled, starting control cycle immediately");
+
+    if (psi && wake != CTRL_W_TMR)
+        log_log(LOG_L_DEBUG, "CPU pressure crossed trigger, starting control cycle immediately");
+
+    if (wake == CTRL_W_TMR)
+        return wake;
+    if (psi)
+        return CTRL_W_PSI;
+    if (alrm)
+        return CTRL_W_ALRM;
+
+    return (tick) ? CTRL_W_TICK : wake;
+}
+
+
+int ctrl_start(t_mons *mons, t_node *fans) {
+    t_zones   *zones     = NULL;
+    t_tmr     *tmr       = NULL;
+    t_tmr     *tick      = NULL;
+    t_evt     *evt       = NULL;
+    t_pwr     *pwr       = NULL;
+    t_fan     *fan       = NULL;
+    t_node    *fans_head = fans;
+    long long cycle      = 0;
+    double    feed       = 0;
+    int       poll_ms    = set_get_int(SET_TIME_POLL);
+    int       wake       = CTRL_W_TMR;
+    int       thr        = 0;
+    int       rd_cycles  = 0;
+    int       rd         = 0;
+    int       ret        = 0;
+    int       i          = 0;
+
 
     if (!fans || !mons)
         return 0;
 
+    zones = zones_load(mons, fans_head);
+    tmr = tmr_init();
+    tick = tmr_init();
+    evt = (tmr && tick) ? ctrl_init_evt(mons, tmr, tick) : NULL;
+    pwr = pwr_load();
+    if (!zones || !tmr || !tick || !evt || !pwr) {
+        log_log(LOG_L_ERROR, "Unable to prepare control loop");
+        zones_free(zones);
+        evt_free(evt);
+        tmr_free(tmr);
+        tmr_free(tick);
+        pwr_free(pwr);
+        return 0;
+    }
+
     for(;;) {
-        if (term_flag)
-            return 1;
+        if (term_flag) {
+            ret = 1;
+            break;
+        }
 
         // SIGHUP catched for reloading of config
         if (rld_flag) {
-            if (!ctrl_rld_conf()) {
-                log_log(LOG_L_ERROR, "Unable to reload configuration file");
-                return 0;
-            }
-            log_log(LOG_L_INFO, "Configuration file reloaded");
             rld_flag = 0;
+            if (ctrl_rld_conf(mons, fans_head, &zones)) {
+                poll_ms = set_get_int(SET_TIME_POLL);
+                ctrl_init_psi(evt);
+                // New poll time may be shorter than current one
+                if ((wake == CTRL_W_SIG || wake == CTRL_W_TICK) && !tmr_arm(tmr, poll_ms, 0)) {
+                    log_log(LOG_L_ERROR, "Unable to arm control loop timer");
+                    break;
+                }
+            }
         }
 
-        // Prepare next fan loop
-        fans = fans_head;
-        ctrl_set_temps(&temps, mons);
-
-        // Write widget file
-        if (set_get_int(SET_WIDGET))
-            wgt_write(fans);
-
-        // Set speed of each fan
-        while (fans) {
-            fan = fans->data;
-            ctrl_calc_spd(&temps, fan);
-            if (!fan_write_spd(fan))
-                log_log(LOG_L_DEBUG, "Unable to set speed of fan %d", fan->id);
-            fans = fans->next;
+        // SIGUSR1 catched for writing status file
+        if (dump_flag) {
+            // Status shows real speeds, not ones read back cycles ago
+            if (!fans_read_spd(fans_head))
+                log_log(LOG_L_DEBUG, "%s", "Unable to read speed of at least one fan");
+            stat_write(mons, zones, fans_head, tmr, pwr);
+            dump_flag = 0;
+        }
+
+        // Slew timer only moves fans further along their ramps
+        if (wake == CTRL_W_TICK) {
+            cycle = time_mono_us();
+            tmr_fired(tick, cycle);
+            if (!ctrl_slew_fans(fans_head, tick, cycle, 1)) {
+                log_log(LOG_L_ERROR, "Unable to arm slew timer");
+                break;
+            }
+        } else if (wake != CTRL_W_SIG) {
+            // Read all monitors and fans at once
+            cycle = time_mono_us();
+            if (wake == CTRL_W_TMR)
+                tmr_fired(tmr, cycle);
+            // Control works from commanded speeds, so real ones are read back only every few cycles
+            rd = (rd_cycles == 0);
+            rd_cycles = (rd_cycles + 1) % set_get_int(SET_FAN_READBACK);
+            swp_read(mons, (rd) ? fans_head : NULL);
+            for (fans = fans_head; rd && fans; fans = fans->next)
+                fan_track(fans->data, cycle);
+            thr = mons_read_thr(mons, cycle);
+            if (thr > 0)
+                log_log(LOG_L_WARN, "CPU throttled %d times, running fans at max speed", thr);
+
+            // Feed-forward is sampled only while enabled, first sample after enabling is base
+            if (set_get_int(SET_FEED_POWER_HIGH) > 0 || set_get_int(SET_FEED_LOAD_HIGH) > 0) {
+                if (!pwr_read(pwr, cycle))
+                    log_log(LOG_L_DEBUG, "%s", "Unable to read feed-forward inputs");
+            } else
+                pwr_reset(pwr);
+            feed = pwr_get_feed(pwr);
+
+            // Prepare next fan loop
+            fans = fans_head;
+            for (i = 0; i < zones->cnt; i++) {
+                ctrl_set_temps(&(zones->zone[i]), mons, cycle);
+                if (set_get_int(SET_CTRL_MODE) == CTRL_M_PID)
+                    ctrl_calc_pid(&(zones->zone[i]), cycle);
+                else if (set_get_int(SET_CTRL_MODE) == CTRL_M_MPC)
+                    ctrl_calc_mpc(&(zones->zone[i]), fans_head, cycle);
+            }
+
+            // Write widget file
+            if (set_get_int(SET_WIDGET) && rd)
+                wgt_write(fans);
+
+            // Calculate target speed of each fan
+            while (fans) {
+                fan = fans->data;
+                ctrl_calc_zones(zones, fan, feed);
+                // Raised alarm or recent CPU throttling overrides zones
+                if (mons->alrm.act > 0 || ctrl_throttled(mons, cycle)) {
+                    fan->spd.tgt = fan->spd.max;
+                    fan->slew.ovr = 1;
+                }
+                fans = fans->next;
+            }
+
+            // Healthy fans take over airflow of stalled or slow ones
+            ctrl_calc_comp(zones, fans_head);
+
+            // Set speed of each fan, limited by slew rate
+            if (!ctrl_slew_fans(fans_head, tick, cycle, 0)) {
+                log_log(LOG_L_ERROR, "Unable to arm slew timer");
+                break;
+            }
+
+            // Rising power draw or CPU pressure is followed by heat, so it is not idle
+            if (feed > 0 || wake == CTRL_W_PSI)
+                poll_ms = set_get_int(SET_TIME_POLL);
+            else
+                poll_ms = ctrl_calc_poll(zones, mons, poll_ms, cycle);
+            log_log(LOG_L_DEBUG, "Control cycle took %lld us (%s sweep %lld us), next one in %d ms",
+                    time_mono_us() - cycle, swp_name(), swp_get_last(), poll_ms);
+
+            // Next deadline is absolute, so time spent in cycle does not shift it
+            if (!tmr_arm(tmr, poll_ms, wake == CTRL_W_TMR)) {
+                log_log(LOG_L_ERROR, "Unable to arm control loop timer");
+                break;
+            }
         }
 
-        // Wait
-        nanosleep(&ts, NULL);
+        // Sleep until any event comes
+        wake = ctrl_wait(evt, mons, fans_head);
     }
 
-    return 1;
-}
\ No newline at end of file
+    zones_free(zones);
+    evt_free(evt);
+    tmr_free(tmr);
+    tmr_free(tick);
+    pwr_free(pwr);
+    return ret;
+}
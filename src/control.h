@@ -11,29 +11,80 @@
 #define MACFAND_CONTROL_H_fsdfdsfsdf
 
 #include "linked.h"
+#include "monitor.h"
+
+/**
+ * @brief Enum holding control modes.
+ * Enum holding control modes, which are speed curve of every fan, PID controller of every zone and
+ * model-predictive controller of every zone.
+ */
+enum ctrl_mode {
+    CTRL_M_CURVE,
+    CTRL_M_PID,
+    CTRL_M_MPC
+};
+
+/**
+ * @brief Struct holding state of PID controller.
+ * Struct holding state of PID controller of one zone, which are integral of error (in °C * s), low-pass
+ * filtered derivative of temperature (in °C / s), time of previous sample (in microseconds, 0 before first
+ * sample) and output (fraction of range between min and max speed of fans in <0, 1>).
+ */
+struct ctrl_pid {
+    double    integ;
+    double    deriv;
+    long long time;
+    double    out;
+};
+
+/**
+ * @brief Struct holding state of model-predictive controller.
+ * Struct holding state of model-predictive controller of one zone. Zone is modeled as dT/dt = theta[0] +
+ * theta[1] * u + theta[2] * x (in °C / s, x is temperature in °C relative to settings->mpc_ceiling, u is speed
+ * of fans as fraction of range between their min and max speed), which is fitted online by recursive least
+ * squares with covariance cov. Holds also previous sample (filtered x, u and time in microseconds, 0 before
+ * first sample), number of fitted samples, whether model is usable, dither added to fan speed, output
+ * (fraction of speed range in <0, 1>, valid only when ok is set) and estimated time to temp_max (in seconds,
+ * -1 when never reached at current fan speed or model is not usable).
+ */
+struct ctrl_mpc {
+    double    theta[3];
+    double    cov[3][3];
+    double    temp;
+    double    spd;
+    long long time;
+    int       cnt;
+    int       ok;
+    double    dith;
+    double    out;
+    double    ttm;
+};
 
 /**
  * @brief Struct holding temperatures needed for adjusting fans.
- * Struct used in main control loop holding all temperatures (previous, real (current), delta of these two
- * and high, low and max from settings).
+ * Struct used in main control loop holding all temperatures (previous and real (current) in millidegrees, rate
+ * of change between these two in millidegrees per second, time of real sample in microseconds (0 before first
+ * sample) and high, low and max from settings in degrees).
  */
 struct ctrl_temps {
-    int prev;
-    int real;
-    int dlt;
-    int high;
-    int low;
-    int max;
+    int       prev;
+    int       real;
+    int       rate;
+    long long time;
+    int       high;
+    int       low;
+    int       max;
 };
 
 /**
  * @brief Infinite loop adjusting fan speed based on current temperature.
- * Starts infinite loop which loads temperatures using control_set_temps(), calculates and sets new speed of every fan
- * in fans using control_calculate_speed() and fan_set_speed(). In case registered signal is catched, returns.
- * @param[in] mons Pointer to head of generic linked list of temperature monitors.
+ * Starts infinite loop which loads temperature of every thermal zone using control_set_temps(), calculates and sets
+ * new speed of every fan in fans from zones driving it using control_calculate_speed() and fan_set_speed().
+ * In case registered signal is catched, returns.
+ * @param[in] mons Pointer to table of temperature monitors.
  * @param[in] fans Pointer to head of generic linked list of system fans.
  * @return int 0 on error, 1 on success
  */
-int ctrl_start(t_node *mons, t_node *fans);
+int ctrl_start(t_mons *mons, t_node *fans);
 
 #endif //MACFAND_CONTROL_H_fsdfdsfsdf
\ No newline at end of file
@@ -0,0 +1,219 @@
+/**
+ * macfand - hipuranyhou - 16.10.2026
+ *
+ * Daemon for controlling fans on Linux systems using
+ * applesmc and coretemp.
+ *
+ * https://github.com/Hipuranyhou/macfand
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "curve.h"
+#include "helper.h"
+#include "settings.h"
+#include "logger.h"
+
+#define CRV_PTS_MAX 32
+#define CRV_SEP_PT  " \t\n"
+
+/**
+ * @brief Struct holding one point of curve.
+ * Struct holding temperature (in millidegrees) and fan speed (in percents of range between min and max speed)
+ * of one point of user curve.
+ */
+struct crv_pt {
+    int temp;
+    int pct;
+};
+
+/**
+ * @brief Parses user curve.
+ * Parses whitespace separated list of temp:pct points with strictly rising temperature (in degrees)
+ * and speed in percents (0-100).
+ * @param[in]  str Curve to be parsed.
+ * @param[out] pts Array of at least CRV_PTS_MAX points.
+ * @param[out] cnt Number of parsed points.
+ * @return int 0 on error, 1 on success.
+ */
+static int crv_parse(const char *const str, struct crv_pt *const pts, int *const cnt);
+
+/**
+ * @brief Gets speed of default curve.
+ * Gets speed (as fraction of range between min and max speed) at given temperature of default curve,
+ * which rises quadratically (continuous version of n * (n + 1) / 2 steps) from 0 at start to 1 at end.
+ * @param[in] temp  Temperature in millidegrees.
+ * @param[in] start Temperature (in degrees) at which curve starts to rise.
+ * @param[in] end   Temperature (in degrees) at which curve reaches max.
+ * @return double fraction of speed range in <0, 1>.
+ */
+static double crv_frac_def(const int temp, const int start, const int end);
+
+/**
+ * @brief Gets speed of user curve.
+ * Gets speed (as fraction of range between min and max speed) at given temperature of piecewise linear
+ * user curve. Curve is flat before its first and after its last point.
+ * @param[in] temp Temperature in millidegrees.
+ * @param[in] pts  Points of curve.
+ * @param[in] cnt  Number of points.
+ * @return double fraction of speed range in <0, 1>.
+ */
+static double crv_frac_pts(const int temp, const struct crv_pt *const pts, const int cnt);
+
+
+static int crv_parse(const char *const str, struct crv_pt *const pts, int *const cnt) {
+    char *buf  = NULL;
+    char *save = NULL;
+    char *tok  = NULL;
+    char *pct  = NULL;
+    int  ret   = 1;
+
+    *cnt = 0;
+
+    buf = (char*)malloc(strlen(str)+1);
+    if (!buf)
+        return 0;
+    strcpy(buf, str);
+
+    for (tok = strtok_r(buf, CRV_SEP_PT, &save); tok; tok = strtok_r(NULL, CRV_SEP_PT, &save)) {
+        pct = strchr(tok, ':');
+        if (!pct || *cnt == CRV_PTS_MAX) {
+            ret = 0;
+            break;
+        }
+        *(pct++) = '\0';
+
+        if (str_to_int(tok, &(pts[*cnt].temp), 10, NULL) < 1 || str_to_int(pct, &(pts[*cnt].pct), 10, NULL) < 1 ||
+            pts[*cnt].pct > 100) {
+            ret = 0;
+            break;
+        }
+        pts[*cnt].temp *= 1000;
+
+        if (*cnt > 0 && pts[*cnt].temp <= pts[*cnt-1].temp) {
+            ret = 0;
+            break;
+        }
+        (*cnt)++;
+    }
+
+    free(buf);
+    return (ret && *cnt > 0);
+}
+
+
+static double crv_frac_def(const int temp, const int start, const int end) {
+    double x = 0;
+    int    n = end - start;
+
+    if (temp <= start * 1000)
+        return 0;
+    if (temp >= end * 1000)
+        return 1;
+
+    x = (temp - start * 1000) / 1000.0;
+    return (x * (x + 1)) / (n * (n + 1));
+}
+
+
+static double crv_frac_pts(const int temp, const struct crv_pt *const pts, const int cnt) {
+    int i = 0;
+
+    if (temp <= pts[0].temp)
+        return pts[0].pct / 100.0;
+
+    for (i = 1; i < cnt; i++)
+        if (temp < pts[i].temp)
+            return (pts[i-1].pct + (double)(pts[i].pct - pts[i-1].pct) * (temp - pts[i-1].temp) /
+                    (pts[i].temp - pts[i-1].temp)) / 100.0;
+
+    return pts[cnt-1].pct / 100.0;
+}
+
+
+int crv_load(t_fan *const fan) {
+    struct crv_pt rise[CRV_PTS_MAX];
+    struct crv_pt fall[CRV_PTS_MAX];
+    const char    *cfg_rise = set_get_str(SET_CURVE);
+    const char    *cfg_fall = set_get_str(SET_CURVE_FALL);
+    uint16_t      *lut      = NULL;
+    double        frac_rise = 0;
+    double        frac_fall = 0;
+    int           rise_cnt  = 0;
+    int           fall_cnt  = 0;
+    int           temp      = 0;
+    int           i         = 0;
+
+    if (!fan)
+        return 0;
+
+    if (cfg_rise && !crv_parse(cfg_rise, rise, &rise_cnt)) {
+        log_log(LOG_L_DEBUG, "Invalid curve %s", cfg_rise);
+        return 0;
+    }
+    if (cfg_fall && !crv_parse(cfg_fall, fall, &fall_cnt)) {
+        log_log(LOG_L_DEBUG, "Invalid falling curve %s", cfg_fall);
+        return 0;
+    }
+
+    lut = (uint16_t*)malloc(2 * CRV_SIZE * sizeof(*lut));
+    if (!lut)
+        return 0;
+
+    for (i = 0; i < CRV_SIZE; i++) {
+        temp = i * CRV_RES;
+
+        // Default curves rise from temp_high and temp_low, user falling curve defaults to rising one
+        if (rise_cnt)
+            frac_rise = crv_frac_pts(temp, rise, rise_cnt);
+        else
+            frac_rise = crv_frac_def(temp, set_get_int(SET_TEMP_HIGH), set_get_int(SET_TEMP_MAX));
+
+        if (fall_cnt)
+            frac_fall = crv_frac_pts(temp, fall, fall_cnt);
+        else if (rise_cnt)
+            frac_fall = frac_rise;
+        else
+            frac_fall = crv_frac_def(temp, set_get_int(SET_TEMP_LOW), set_get_int(SET_TEMP_MAX));
+
+        // Always full speed over temp_max (and end of table), falling branch never under rising one
+        if (temp >= set_get_int(SET_TEMP_MAX) * 1000 || i == CRV_SIZE - 1)
+            frac_rise = 1;
+        if (frac_fall < frac_rise)
+            frac_fall = frac_rise;
+
+        lut[i] = fan->spd.min + (fan->spd.max - fan->spd.min) * frac_rise + 0.5;
+        lut[CRV_SIZE+i] = fan->spd.min + (fan->spd.max - fan->spd.min) * frac_fall + 0.5;
+    }
+
+    if (fan->crv.rise)
+        free(fan->crv.rise);
+    fan->crv.rise = lut;
+    fan->crv.fall = lut + CRV_SIZE;
+
+    return 1;
+}
+
+
+int crvs_load(t_node *fans) {
+    int state = 1;
+
+    for (; fans; fans = fans->next) {
+        if (!crv_load(fans->data)) {
+            log_log(LOG_L_DEBUG, "Unable to compile curve of fan %d", ((t_fan*)fans->data)->id);
+            state = 0;
+        }
+    }
+
+    return state;
+}
+
+
+int crv_get_spd(const t_fan *const fan, const int temp) {
+    int idx = temp / CRV_RES;
+
+    idx = (idx < 0) ? 0 : ((idx >= CRV_SIZE) ? CRV_SIZE - 1 : idx);
+
+    return min(max(fan_get_spd(fan), fan->crv.rise[idx]), fan->crv.fall[idx]);
+}
@@ -0,0 +1,58 @@
+/**
+ * macfand - hipuranyhou - 16.10.2026
+ *
+ * Daemon for controlling fans on Linux systems using
+ * applesmc and coretemp.
+ *
+ * https://github.com/Hipuranyhou/macfand
+ */
+
+#ifndef MACFAND_CURVE_H_vbnmqwerty
+#define MACFAND_CURVE_H_vbnmqwerty
+
+#include "linked.h"
+#include "fan.h"
+
+/**
+ * @brief Resolution of speed curve.
+ * Number of millidegrees covered by one entry of speed lookup table (0.125°C).
+ */
+#define CRV_RES 125
+
+/**
+ * @brief Size of speed curve.
+ * Number of entries of each branch of speed lookup table, which covers 0°C to 128°C. Last entry (used
+ * for every higher temperature) always holds max speed.
+ */
+#define CRV_SIZE 1024
+
+/**
+ * @brief Compiles speed curve of given fan.
+ * Compiles rising and falling branch of speed lookup table of given fan from curve and curve_fall settings,
+ * or from temp_low, temp_high and temp_max when curve is not set. Previous table of fan is replaced only
+ * on success.
+ * @param[in,out] fan Pointer to fan.
+ * @return int 0 on error, 1 on success.
+ */
+int crv_load(t_fan *const fan);
+
+/**
+ * @brief Compiles speed curves of all fans.
+ * Compiles speed lookup table of every fan using crv_load().
+ * @param[in,out] fans Pointer to head of generic linked list of system fans.
+ * @return int 0 if compiling of at least one curve failed, 1 on success.
+ */
+int crvs_load(t_node *fans);
+
+/**
+ * @brief Gets target speed of given fan.
+ * Gets target speed of given fan at given temperature from its speed lookup table. Current speed (see
+ * fan_get_spd()) under rising branch is raised to it, above falling branch is lowered to it and between
+ * them is kept.
+ * @param[in] fan  Pointer to fan.
+ * @param[in] temp Temperature in millidegrees.
+ * @return int target speed of fan.
+ */
+int crv_get_spd(const t_fan *const fan, const int temp);
+
+#endif //MACFAND_CURVE_H_vbnmqwerty
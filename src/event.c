@@ -0,0 +1,288 @@
+/**
+ * macfand - hipuranyhou - 16.10.2026
+ *
+ * Daemon for controlling fans on Linux systems using
+ * applesmc and coretemp.
+ *
+ * https://github.com/Hipuranyhou/macfand
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/signalfd.h>
+#include <sys/inotify.h>
+
+#include "event.h"
+#include "uevent.h"
+#include "logger.h"
+
+#define EVT_INO_BUF  4096
+#define EVT_INO_MASK (IN_CLOSE_WRITE | IN_MOVED_TO)
+#define EVT_PSI_PATH "/proc/pressure/cpu"
+
+/**
+ * @brief Prepares set of signals.
+ * Prepares set of signals delivered through event loop.
+ * @param[out] set Pointer to set of signals.
+ * @return int 0 on error, 1 on success.
+ */
+static int evt_sig_set(sigset_t *const set);
+
+
+static int evt_sig_set(sigset_t *const set) {
+    if (sigemptyset(set) < 0)
+        return 0;
+
+    if (sigaddset(set, SIGABRT) < 0 ||
+        sigaddset(set, SIGINT) < 0  ||
+        sigaddset(set, SIGQUIT) < 0 ||
+        sigaddset(set, SIGTERM) < 0 ||
+        sigaddset(set, SIGHUP) < 0  ||
+        sigaddset(set, SIGUSR1) < 0)
+        return 0;
+
+    return 1;
+}
+
+
+int evt_block_sig(void) {
+    sigset_t set;
+
+    return (evt_sig_set(&set) && sigprocmask(SIG_BLOCK, &set, NULL) == 0);
+}
+
+
+t_evt *evt_init(void) {
+    t_evt    *evt = NULL;
+    sigset_t set;
+
+    evt = (t_evt*)malloc(sizeof(*evt));
+    if (!evt)
+        return NULL;
+
+    evt->sig = -1;
+    evt->ino = -1;
+    evt->uev = -1;
+    evt->psi = -1;
+    evt->psi_stall = 0;
+    evt->psi_win = 0;
+    evt->conf = NULL;
+    evt->cnt = 0;
+
+    evt->fd = epoll_create1(EPOLL_CLOEXEC);
+    if (evt->fd < 0) {
+        log_log(LOG_L_DEBUG, "Unable to create epoll: %s", strerror(errno));
+        free(evt);
+        return NULL;
+    }
+
+    // Signals which are not blocked would interrupt epoll_wait() instead of being reported
+    if (!evt_sig_set(&set) || sigprocmask(SIG_BLOCK, &set, NULL) < 0) {
+        log_log(LOG_L_DEBUG, "%s", "Unable to block signals");
+        evt_free(evt);
+        return NULL;
+    }
+
+    evt->sig = signalfd(-1, &set, SFD_CLOEXEC | SFD_NONBLOCK);
+    if (evt->sig < 0 || !evt_add(evt, evt->sig, EPOLLIN, EVT_T_SIG, 0)) {
+        log_log(LOG_L_DEBUG, "Unable to create signalfd: %s", strerror(errno));
+        evt_free(evt);
+        return NULL;
+    }
+
+    return evt;
+}
+
+
+int evt_add(t_evt *const evt, const int fd, const uint32_t events, const enum evt_type type, const int idx) {
+    struct epoll_event ev;
+
+    if (!evt || fd < 0)
+        return 0;
+
+    ev.events = events;
+    ev.data.u64 = ((uint64_t)type << 32) | (uint32_t)idx;
+
+    if (epoll_ctl(evt->fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        log_log(LOG_L_DEBUG, "Unable to add event source %d/%d: %s", type, idx, strerror(errno));
+        return 0;
+    }
+
+    return 1;
+}
+
+
+int evt_watch_conf(t_evt *const evt, const char *const path) {
+    const char *name = NULL;
+    char       *dir  = NULL;
+    int        ret   = 0;
+
+    if (!evt || !path)
+        return 0;
+
+    name = strrchr(path, '/');
+    name = (name) ? name + 1 : path;
+
+    dir = (char*)malloc((name > path) ? (size_t)(name - path) + 1 : 2);
+    evt->conf = (char*)malloc(strlen(name) + 1);
+    if (!dir || !evt->conf) {
+        free(dir);
+        return 0;
+    }
+    strcpy(evt->conf, name);
+
+    // Directory is watched, because editors often replace file instead of writing it
+    if (name > path) {
+        memcpy(dir, path, name - path);
+        dir[name - path] = '\0';
+    } else
+        strcpy(dir, ".");
+
+    evt->ino = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+    if (evt->ino < 0)
+        log_log(LOG_L_DEBUG, "Unable to create inotify: %s", strerror(errno));
+    else if (inotify_add_watch(evt->ino, dir, EVT_INO_MASK) < 0)
+        log_log(LOG_L_DEBUG, "Unable to watch %s: %s", dir, strerror(errno));
+    else
+        ret = evt_add(evt, evt->ino, EPOLLIN, EVT_T_CONF, 0);
+
+    free(dir);
+    return ret;
+}
+
+
+int evt_watch_uev(t_evt *const evt) {
+    if (!evt)
+        return 0;
+
+    evt->uev = uev_open();
+    if (evt->uev < 0)
+        return 0;
+
+    if (!evt_add(evt, evt->uev, EPOLLIN, EVT_T_UEV, 0)) {
+        close(evt->uev);
+        evt->uev = -1;
+        return 0;
+    }
+
+    return 1;
+}
+
+
+int evt_watch_psi(t_evt *const evt, const int stall, const int win) {
+    char buf[64];
+    int  len = 0;
+
+    if (!evt)
+        return 0;
+
+    if (stall == evt->psi_stall && win == evt->psi_win && (evt->psi >= 0 || stall == 0))
+        return 1;
+
+    // Closing trigger also removes it from epoll
+    if (evt->psi >= 0)
+        close(evt->psi);
+    evt->psi = -1;
+    evt->psi_stall = stall;
+    evt->psi_win = win;
+    if (stall == 0)
+        return 1;
+
+    len = snprintf(buf, sizeof(buf), "some %d %d", stall * 1000, win * 1000);
+    if (len < 1 || (size_t)len >= sizeof(buf))
+        return 0;
+
+    // Trigger is registered by writing it and lives until file is closed
+    evt->psi = open(EVT_PSI_PATH, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (evt->psi < 0 || write(evt->psi, buf, len + 1) < 0 || !evt_add(evt, evt->psi, EPOLLPRI, EVT_T_PSI, 0)) {
+        log_log(LOG_L_DEBUG, "Unable to register trigger %s on %s: %s", buf, EVT_PSI_PATH, strerror(errno));
+        if (evt->psi >= 0)
+            close(evt->psi);
+        evt->psi = -1;
+        return 0;
+    }
+
+    return 1;
+}
+
+
+int evt_wait(t_evt *const evt) {
+    if (!evt)
+        return -1;
+
+    evt->cnt = epoll_wait(evt->fd, evt->ev, EVT_MAX, -1);
+    if (evt->cnt < 0) {
+        evt->cnt = 0;
+        if (errno == EINTR)
+            return 0;
+        log_log(LOG_L_DEBUG, "Unable to wait for events: %s", strerror(errno));
+        return -1;
+    }
+
+    return evt->cnt;
+}
+
+
+enum evt_type evt_get_type(const t_evt *const evt, const int i) {
+    return (enum evt_type)(evt->ev[i].data.u64 >> 32);
+}
+
+
+int evt_get_idx(const t_evt *const evt, const int i) {
+    return (int)(uint32_t)evt->ev[i].data.u64;
+}
+
+
+int evt_read_sig(const t_evt *const evt) {
+    struct signalfd_siginfo info;
+
+    if (!evt || read(evt->sig, &info, sizeof(info)) != sizeof(info))
+        return 0;
+
+    return (int)info.ssi_signo;
+}
+
+
+int evt_read_conf(const t_evt *const evt) {
+    struct inotify_event ev;
+    char                 buf[EVT_INO_BUF];
+    ssize_t              rd_ret = 0;
+    ssize_t              pos    = 0;
+    int                  ret    = 0;
+
+    if (!evt || evt->ino < 0)
+        return 0;
+
+    while ((rd_ret = read(evt->ino, buf, sizeof(buf))) > 0) {
+        for (pos = 0; pos + (ssize_t)sizeof(ev) <= rd_ret; pos += sizeof(ev) + ev.len) {
+            memcpy(&ev, buf + pos, sizeof(ev));
+            if (ev.len && (ev.mask & EVT_INO_MASK) && strcmp(buf + pos + sizeof(ev), evt->conf) == 0)
+                ret = 1;
+        }
+    }
+
+    return ret;
+}
+
+
+void evt_free(t_evt *evt) {
+    if (!evt)
+        return;
+
+    if (evt->sig >= 0)
+        close(evt->sig);
+    if (evt->ino >= 0)
+        close(evt->ino);
+    if (evt->uev >= 0)
+        close(evt->uev);
+    if (evt->psi >= 0)
+        close(evt->psi);
+    close(evt->fd);
+    free(evt->conf);
+    free(evt);
+}
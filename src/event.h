@@ -0,0 +1,161 @@
+/**
+ * macfand - hipuranyhou - 16.10.2026
+ *
+ * Daemon for controlling fans on Linux systems using
+ * applesmc and coretemp.
+ *
+ * https://github.com/Hipuranyhou/macfand
+ */
+
+#ifndef MACFAND_EVENT_H_qoeiruvnbz
+#define MACFAND_EVENT_H_qoeiruvnbz
+
+#include <stdint.h>
+#include <sys/epoll.h>
+
+#define EVT_MAX 16
+
+/**
+ * @brief Enum holding event types.
+ * Enum holding types of event sources, which are signals, control loop timer, configuration file changes,
+ * alarms of monitors, kernel uevents and CPU pressure trigger.
+ */
+enum evt_type {
+    EVT_T_SIG,
+    EVT_T_TMR,
+    EVT_T_CONF,
+    EVT_T_ALRM,
+    EVT_T_UEV,
+    EVT_T_PSI
+};
+
+/**
+ * @brief Event loop type.
+ * Type for epoll event loop holding epoll, signalfd, inotify, uevent socket and CPU pressure trigger file descriptors
+ * (inotify is -1 when configuration file is not watched, uevent socket is -1 when uevents are not watched, pressure
+ * trigger is -1 when not registered), stall and window (in milliseconds) pressure trigger was requested with, name
+ * of watched configuration file, number of ready events and ready events themselves.
+ */
+typedef struct evt {
+    int                fd;
+    int                sig;
+    int                ino;
+    int                uev;
+    int                psi;
+    int                psi_stall;
+    int                psi_win;
+    char               *conf;
+    int                cnt;
+    struct epoll_event ev[EVT_MAX];
+} t_evt;
+
+/**
+ * @brief Constructs event loop.
+ * Constructs epoll event loop with signalfd for termination (SIGABRT, SIGINT, SIGQUIT and SIGTERM), reload (SIGHUP)
+ * and status (SIGUSR1) signals. Signals are blocked by evt_block_sig() (again), so they are delivered only through
+ * event loop.
+ * @return t_evt* NULL on error, pointer to event loop otherwise (has to be freed by evt_free()).
+ */
+t_evt *evt_init(void);
+
+/**
+ * @brief Blocks signals delivered through event loop.
+ * Blocks termination, reload and status signals for the rest of run of daemon. Signals sent before event loop is
+ * constructed stay pending and are read from its signalfd, signals sent after it is freed are never delivered.
+ * @return int 0 on error, 1 on success.
+ */
+int evt_block_sig(void);
+
+/**
+ * @brief Adds event source.
+ * Adds given file descriptor with given epoll events to event loop as event source of given type and index.
+ * @param[in,out] evt    Pointer to event loop.
+ * @param[in]     fd     File descriptor of event source.
+ * @param[in]     events Epoll events (EPOLLIN, EPOLLPRI, ...).
+ * @param[in]     type   Type of event source.
+ * @param[in]     idx    Index of event source amongst sources of its type.
+ * @return int 0 on error, 1 on success.
+ */
+int evt_add(t_evt *const evt, const int fd, const uint32_t events, const enum evt_type type, const int idx);
+
+/**
+ * @brief Watches configuration file.
+ * Watches directory of configuration file at given path with inotify, so writing or replacing configuration
+ * file is reported as EVT_T_CONF event.
+ * @param[in,out] evt  Pointer to event loop.
+ * @param[in]     path Path to configuration file.
+ * @return int 0 on error, 1 on success.
+ */
+int evt_watch_conf(t_evt *const evt, const char *const path);
+
+/**
+ * @brief Watches kernel uevents.
+ * Opens uevent socket, so appearing and disappearing devices are reported as EVT_T_UEV event.
+ * @param[in,out] evt Pointer to event loop.
+ * @return int 0 on error, 1 on success.
+ */
+int evt_watch_uev(t_evt *const evt);
+
+/**
+ * @brief Watches CPU pressure.
+ * Registers PSI trigger on /proc/pressure/cpu, which is reported as EVT_T_PSI event when some tasks stall on CPU
+ * for at least given time within given window. Previous trigger is replaced, trigger requested with same values
+ * is kept and stall 0 removes trigger.
+ * @param[in,out] evt   Pointer to event loop.
+ * @param[in]     stall Stall time in milliseconds.
+ * @param[in]     win   Window in milliseconds (500 - 10000).
+ * @return int 0 on error, 1 on success.
+ */
+int evt_watch_psi(t_evt *const evt, const int stall, const int win);
+
+/**
+ * @brief Waits for events.
+ * Waits until at least one event source is ready or signal not delivered through event loop is catched.
+ * @param[in,out] evt Pointer to event loop.
+ * @return int -1 on error, number of ready events otherwise (0 when interrupted).
+ */
+int evt_wait(t_evt *const evt);
+
+/**
+ * @brief Gets type of ready event.
+ * Gets type of i-th ready event returned by last evt_wait().
+ * @param[in] evt Pointer to event loop.
+ * @param[in] i   Index of ready event.
+ * @return enum evt_type type of event source.
+ */
+enum evt_type evt_get_type(const t_evt *const evt, const int i);
+
+/**
+ * @brief Gets index of ready event.
+ * Gets index of source of i-th ready event returned by last evt_wait() amongst sources of its type.
+ * @param[in] evt Pointer to event loop.
+ * @param[in] i   Index of ready event.
+ * @return int index of event source.
+ */
+int evt_get_idx(const t_evt *const evt, const int i);
+
+/**
+ * @brief Reads pending signal.
+ * Reads one pending signal from signalfd of event loop.
+ * @param[in] evt Pointer to event loop.
+ * @return int 0 if no signal is pending (or on error), number of signal otherwise.
+ */
+int evt_read_sig(const t_evt *const evt);
+
+/**
+ * @brief Reads configuration file changes.
+ * Reads all pending inotify events and checks whether any of them concerns configuration file.
+ * @param[in] evt Pointer to event loop.
+ * @return int 0 if configuration file did not change, 1 otherwise.
+ */
+int evt_read_conf(const t_evt *const evt);
+
+/**
+ * @brief Frees memory for given event loop.
+ * Closes all file descriptors of event loop (not of added event sources) and calls free() on event loop. Signals
+ * stay blocked, so they do not interrupt restore of fans.
+ * @param[in] evt Pointer to event loop.
+ */
+void evt_free(t_evt *evt);
+
+#endif //MACFAND_EVENT_H_qoeiruvnbz
@@ -7,305 +7,244 @@
  * https://github.com/Hipuranyhou/macfand
  */
 
-#include <dirent.h>
 #include <stdlib.h>
 #include <string.h>
-#include <errno.h>
+#include <fcntl.h>
 
 #include "fan.h"
 #include "helper.h"
 #include "logger.h"
 #include "settings.h"
+#include "curve.h"
+#include "smc.h"
+#include "pwm.h"
 
-#define FAN_PATH_BASE "/sys/devices/platform/applesmc.768"
-#define FAN_PATH_RD   "input"
-#define FAN_PATH_WR   "output"
-#define FAN_PATH_MAX  "max"
-#define FAN_PATH_MIN  "min"
-#define FAN_PATH_MOD  "manual"
-#define FAN_PATH_LBL  "label"
-#define FAN_PATH_FMT  FAN_PATH_BASE "/fan%d_%s"
+#define FAN_STALL_RPM 100
 
 /**
- * @brief Loads label of fan.
- * Loads label of given fan by reading the appropriate system file.
- * @param[in,out] fan Pointer to fan. 
+ * @brief Opens handles of fan.
+ * Opens reading, writing and mode setting handles of given fan.
+ * @param[in,out] fan Pointer to fan.
  * @return int 0 on error, 1 on success.
  */
-static int fan_load_lbl(t_fan *const fan);
+static int fan_open_hnd(t_fan *const fan);
 
 /**
- * @brief Selects where should fan read speed end and from where should be read.
- * Changes *dest to proper location of where should be speed saved after reading and *path 
- * to from where should be speed read for given fan based on path suffix.
- * @param[in]  fan  Pointer to fan which speed should be read.
- * @param[in]  suff Suffix of speed file from which we read speed.
- * @param[out] dest Pointer where should be read value destination saved.
- * @param[out] path Pointer where should be read path saved.
+ * @brief Recovers fan after its device went away.
+ * Reopens all handles of given fan and sets it back to manual mode, because fan devices (applesmc,
+ * hwmon chips) reset fans to automatic mode when they are loaded again.
+ * @param[in,out] fan Pointer to fan.
  * @return int 0 on error, 1 on success.
  */
-static int fan_sel_spd_dest(t_fan *const fan, const char *const suff, int **const dest, char **const path);
+static int fan_recover(t_fan *const fan);
 
 /**
- * @brief Loads given speed of fan.
- * Loads speed of given fan by reading the appropriate system file.
- * @param[in,out] fan  Pointer to fan which speed should be read.
- * @param[in]     suff Path end of wanted speed (one of FAN_PATH_MAX, FAN_PATH_MIN or FAN_PATH_RD).
- * @return int 0 on error, 1 on success.
- */ 
-static int fan_read_spd(t_fan *const fan, const char *const suff);
-
-/**
- * @brief Loads default values for given fan.
- * Loads max and min speed of given fan, calculates its step size based on these values, constructs its
- * reading, writing and mode setting paths and finally loads its label.
- * @param[in,out] fan Pointer to fan to be loaded.
- * @return int 0 on error, 1 on success.
+ * @brief Checks whether fan lives on given device.
+ * Checks whether device of given fan is device with given path or its child (path continues after '/').
+ * @param[in] fan Pointer to fan.
+ * @param[in] dev Path of device.
+ * @return int 0 if fan does not live on device, 1 otherwise.
  */
-static int fan_load_def(t_fan *const fan);
+static int fan_on_dev(const t_fan *const fan, const char *const dev);
 
-/**
- * @brief Filters out files not starting filename with "fan".
- * Filters out files not starting filename with "fan" when using scandir().
- * @param[in] dirent Pointer to dirent entry which filename we check.
- * @return int 0 on not starting, 1 on starting.
- */
-static int fans_load_filter(const struct dirent *dirent);
 
+static int fan_open_hnd(t_fan *const fan) {
+    if (!fan)
+        return 0;
 
-static int fan_load_lbl(t_fan *const fan) {
-    char    *path    = NULL;
-    FILE    *file    = NULL;
-    ssize_t get_ret  = 0;
-    size_t  lbl_size = 0;
+    // Initialize all handles first, so they can be safely closed on error
+    if (!hnd_open(&(fan->hnd.rd), fan->path.rd, O_RDONLY) |
+        !hnd_open(&(fan->hnd.wr), fan->path.wr, O_WRONLY) |
+        !hnd_open(&(fan->hnd.mod), fan->path.mod, O_WRONLY))
+        return 0;
 
-    if (!fan)
+    return 1;
+}
+
+
+static int fan_on_dev(const t_fan *const fan, const char *const dev) {
+    size_t len = strlen(dev);
+
+    if (!fan->path.dev || strncmp(fan->path.dev, dev, len) != 0)
         return 0;
 
-    fan->lbl = NULL;
+    // Removal of parent device (platform or PCI device of hwmon chip) removes fan device as well
+    return (fan->path.dev[len] == '\0' || fan->path.dev[len] == '/');
+}
 
-    path = concat_fmt(FAN_PATH_FMT, fan->id, FAN_PATH_LBL);
-    if (!path)
+
+static int fan_recover(t_fan *const fan) {
+    if (!fan)
         return 0;
 
-    file = fopen(path, "r");
-    free(path);
-    if (!file) {
-        log_log(LOG_L_DEBUG, "Unable to open label file of fan %d", fan->id);
+    if (!hnd_reopen(&(fan->hnd.rd)) || !hnd_reopen(&(fan->hnd.wr)) || !hnd_reopen(&(fan->hnd.mod))) {
+        log_log(LOG_L_DEBUG, "Unable to reopen handles of fan %d", fan->id);
         return 0;
     }
 
-    errno = 0;
-    get_ret = getline(&(fan->lbl), &lbl_size, file);
-    if (get_ret < 2 || errno != 0) {
-        log_log(LOG_L_DEBUG, "Unable to load label of fan %d", fan->id);
-        if (fclose(file) == EOF)
-            log_log(LOG_L_DEBUG, "Unable to close label file of fan %d", fan->id);
+    // Fan may have lost its speed together with handles
+    fan->cmd.spd = -1;
+
+    if (!fan->bknd->write_mod(fan, FAN_M_MAN)) {
+        log_log(LOG_L_DEBUG, "Unable to set fan %d back to manual mode", fan->id);
         return 0;
     }
 
-    // (get_ret - 2) because line ends with "'0x10''0x0A'"
-    fan->lbl[get_ret-2] = '\0';
-
-    if (fclose(file) == EOF)
-        log_log(LOG_L_DEBUG, "Unable to close label file of fan %d", fan->id);
+    log_log(LOG_L_INFO, "Recovered handles of fan %d", fan->id);
     return 1;
 }
 
 
-static int fan_sel_spd_dest(t_fan *const fan, const char *const suff, int **const dest, char **const path) {
-    if (!fan || !suff || !dest || !path)
-        return 0;
+t_node* fans_load(void) {
+    int    type = set_get_int(SET_FAN_BACKEND);
+    t_node *fans = NULL;
 
-    if (strcmp(FAN_PATH_MIN, suff) == 0) {
-        *dest = &(fan->spd.min);
-        *path = fan->path.min;
-    } else if (strcmp(FAN_PATH_MAX, suff) == 0) {
-        *dest = &(fan->spd.max);
-        *path = fan->path.max;
-    } else
-        return 0;
+    if (type == FAN_B_AUTO || type == FAN_B_SMC)
+        fans = smc_bknd.load();
+    if (!fans && (type == FAN_B_AUTO || type == FAN_B_PWM))
+        fans = pwm_bknd.load();
 
-    if (!(*path))
-        return 0;
-    return 1;
+    if (!fans) {
+        log_log(LOG_L_DEBUG, "%s", "No fans found by selected fan backend");
+        return NULL;
+    }
+
+    log_log(LOG_L_INFO, "Using %s fan backend", ((t_fan*)fans->data)->bknd->name);
+    return fans;
 }
 
 
-static int fan_read_spd(t_fan *const fan, const char *const suff) {
-    char    *str     = NULL;
-    size_t  str_size = 0;
-    ssize_t get_ret  = 0;
-    FILE    *file    = NULL;
-    int     *rd_dest = &(fan->spd.real);
-    char    *rd_path = fan->path.rd;
+void fan_clear(t_fan *const fan) {
+    fan->lbl = NULL;
+    fan->bknd = NULL;
+    fan->mod = FAN_M_AUTO;
+    fan->path.rd = NULL;
+    fan->path.wr = NULL;
+    fan->path.mod = NULL;
+    fan->path.min = NULL;
+    fan->path.max = NULL;
+    fan->path.dev = NULL;
+    fan->hnd.rd.fd = -1;
+    fan->hnd.wr.fd = -1;
+    fan->hnd.mod.fd = -1;
+    fan->crv.rise = NULL;
+    fan->crv.fall = NULL;
+}
 
-    if (!fan || (suff && !fan_sel_spd_dest(fan, suff, &rd_dest, &rd_path)))
-        return 0;
 
-    // Open file for reading
-    file = fopen(rd_path, "r");
-    if (!file) {
-        log_log(LOG_L_DEBUG, "Unable to open speed file of fan %d", fan->id);
+int fan_load(t_fan *const fan) {
+    if (!fan || !fan->bknd)
         return 0;
-    }
 
-    // Read line from speed file and remove trailing '\n'
-    errno = 0;
-    get_ret = getline(&str, &str_size, file);
-    if (get_ret < 2 || errno != 0) {
-        log_log(LOG_L_DEBUG, "Invalid speed file of fan %d", fan->id);
-        if (str)
-            free(str);
-        if (fclose(file) == EOF)
-            log_log(LOG_L_DEBUG, "Unable to close speed file of fan %d", fan->id);
+    fan->spd.real = 0;
+    fan->spd.tgt = 0;
+    fan->cmd.spd = -1;
+    fan->cmd.time = 0;
+    fan->cmd.up = 0;
+    fan->cmd.writes = 0;
+    fan->cmd.start = time_mono_us();
+    fan->slew.spd = -1;
+    fan->slew.time = 0;
+    fan->slew.ovr = 0;
+    fan->trk.state = FAN_S_OK;
+    fan->trk.miss = 0;
+    fan->trk.err = 0;
+    fan->trk.since = 0;
+    fan->trk.faults = 0;
+
+    // Compile speed lookup table
+    if (!crv_load(fan)) {
+        log_log(LOG_L_DEBUG, "Unable to compile curve of fan %d", fan->id);
         return 0;
     }
-    str[get_ret-1] = '\0';
 
-    // Convert read line to integer
-    if (str_to_int(str, rd_dest, 10, NULL) < 1) {
-        log_log(LOG_L_DEBUG, "Invalid speed of fan %d", fan->id);
-        free(str);
-        if (fclose(file) == EOF)
-            log_log(LOG_L_DEBUG, "Unable to close speed file of fan %d", fan->id);
+    // Open handles used while controlling fan
+    if (!fan_open_hnd(fan)) {
+        log_log(LOG_L_DEBUG, "Unable to open read, write or mode file of fan %d", fan->id);
         return 0;
     }
 
-    free(str);
-    if (fclose(file) == EOF)
-        log_log(LOG_L_DEBUG, "Unable to close speed file of fan %d", fan->id);
     return 1;
 }
 
 
-static int fan_load_def(t_fan *const fan) {
-    int temp_max  = set_get_int(SET_TEMP_MAX);
-    int temp_high = set_get_int(SET_TEMP_HIGH);
+int fans_write_mod(const t_node *fans, const enum fan_mode mod) {
+    int   state = 1;
+    t_fan *fan  = NULL;
 
-    if (!fan)
+    if (!fans || mod < FAN_M_AUTO || mod > FAN_M_MAN)
         return 0;
 
-    // Load all paths of given fan
-    fan->path.rd = concat_fmt(FAN_PATH_FMT, fan->id, FAN_PATH_RD);
-    fan->path.wr = concat_fmt(FAN_PATH_FMT, fan->id, FAN_PATH_WR);
-    fan->path.mod = concat_fmt(FAN_PATH_FMT, fan->id, FAN_PATH_MOD);
-    fan->path.min = concat_fmt(FAN_PATH_FMT, fan->id, FAN_PATH_MIN);
-    fan->path.max = concat_fmt(FAN_PATH_FMT, fan->id, FAN_PATH_MAX);
-    if (!fan->path.rd || !fan->path.wr || !fan->path.mod || !fan->path.min || !fan->path.max) {
-        log_log(LOG_L_DEBUG, "Unable to load read, write or mode path of fan %d", fan->id);
-        return 0;
-    }
+    while (fans) {
+        fan = fans->data;
 
-    // Load min and max speed of given fan
-    if (!fan_read_spd(fan, FAN_PATH_MIN) || !fan_read_spd(fan, FAN_PATH_MAX)) {
-        log_log(LOG_L_DEBUG, "Unable to load max or min speed of fan %d", fan->id);
-        return 0;
+        if (!fan->bknd->write_mod(fan, mod)) {
+            log_log(LOG_L_DEBUG, "Unable to write mode of fan %d", fan->id);
+            state = 0;
+        }
+
+        fans = fans->next;
     }
 
-    fan->spd.real = 0;
-    fan->spd.tgt = 0;
+    return state;
+}
 
-    // Calculate size of one unit of fan speed change
-    fan->spd.step = (fan->spd.max - fan->spd.min) / ((temp_max - temp_high) * (temp_max - temp_high + 1) / 2);
 
-    // Load fan label
-    if (!fan_load_lbl(fan)) {
-        log_log(LOG_L_DEBUG, "Unable to load label of fan %d", fan->id);
+int fans_has_dev(const t_node *fans, const char *const dev) {
+    const t_fan *fan = NULL;
+
+    if (!dev)
         return 0;
+
+    for (; fans; fans = fans->next) {
+        fan = fans->data;
+        if (fan_on_dev(fan, dev))
+            return 1;
     }
 
-    return 1;
+    return 0;
 }
 
 
-static int fans_load_filter(const struct dirent *dirent) {
-    return (strncmp(dirent->d_name, "fan", 3) == 0);
-}
+int fans_recover(t_node *fans, const char *const dev) {
+    int   state = 1;
+    t_fan *fan  = NULL;
 
+    if (!dev)
+        return 0;
 
-t_node* fans_load(void) {
-    struct dirent **names    = NULL;
-    int           names_size = 0;
-    char          inv        = 0;
-    int           id_prev    = 0;
-    int           to_int_ret = 0;
-    t_fan         fan;
-    t_node        *fans      = NULL;
-
-    errno = 0;
-    names_size = scandir(FAN_PATH_BASE, &names, fans_load_filter, alphasort);
-    if (names_size < 0) {
-        log_log(LOG_L_DEBUG, "Unable to open system fans directory.");
-        return NULL;
+    for (; fans; fans = fans->next) {
+        fan = fans->data;
+        if (fan_on_dev(fan, dev) && !fan_recover(fan))
+            state = 0;
     }
 
-    // Walk through fans directory
-    while (names_size--) {
-        // Get id of fan
-        to_int_ret = str_to_int(names[names_size]->d_name+3, &(fan.id), 10, &inv);
-        if (to_int_ret < 0 || inv != '_') {
-            list_free(fans, (void (*)(void *, int))fan_free);
-            fan_free(&fan, 0);
-            free_dirent_names(names, names_size);
-            log_log(LOG_L_DEBUG, "Invalid fan filename encountered.");
-            return NULL;
-        }
+    return state;
+}
 
-        // Skip already finished fan
-        if (fan.id == id_prev) {
-            free(names[names_size]);
-            continue;
-        }
-        id_prev = fan.id;
-
-        // Load fan defaults and append it to linked list of fans
-        if (!fan_load_def(&fan) || !list_push_front(&fans, &fan, sizeof(fan))) {
-            list_free(fans, (void (*)(void *, int))fan_free);
-            fan_free(&fan, 0);
-            free_dirent_names(names, names_size);
-            log_log(LOG_L_DEBUG, "Unable to load defaults of fan %d", fan.id);
-            return NULL;
-        }
 
-        free(names[names_size]);
+int fan_read_spd(t_fan *const fan) {
+    if (!fan)
+        return 0;
+
+    if (!hnd_read_int(&(fan->hnd.rd), &(fan->spd.real)) &&
+        (!fan_recover(fan) || !hnd_read_int(&(fan->hnd.rd), &(fan->spd.real)))) {
+        log_log(LOG_L_DEBUG, "Invalid speed of fan %d", fan->id);
+        return 0;
     }
 
-    if (names)
-        free(names);
-    return fans;
+    return 1;
 }
 
 
-int fans_write_mod(const t_node *fans, const enum fan_mode mod) {
+int fans_read_spd(t_node *fans) {
     int   state = 1;
-    FILE  *file = NULL;
     t_fan *fan  = NULL;
 
-    if (!fans || mod < FAN_M_AUTO || mod > FAN_M_MAN)
-        return 0;
-
     while (fans) {
         fan = fans->data;
-
-        file = fopen(fan->path.mod, "w+");
-        if (!file) {
-            log_log(LOG_L_DEBUG, "Unable to open mode file of fan %d", fan->id);
-            state = 0;
-            fans = fans->next;
-            continue;
-        }
-
-        if (fprintf(file, "%d\n", mod) < 0) {
-            log_log(LOG_L_DEBUG, "Unable to write mode of fan %d", fan->id);
-            state = 0;
-        }
-
-        if (fclose(file) == EOF) {
-            log_log(LOG_L_DEBUG, "Unable to close mode file of fan %d", fan->id);
+        if (!fan_read_spd(fan))
             state = 0;
-        }
-
         fans = fans->next;
     }
 
@@ -314,48 +253,174 @@ int fans_write_mod(const t_node *fans, const enum fan_mode mod) {
 
 
 int fan_write_spd(t_fan *const fan) {
-    FILE *file = NULL;
+    long long now = time_mono_us();
+    int       tgt = 0;
+    int       cmd = 0;
 
     if (!fan)
         return 0;
 
-    // Check current fan speed
-    if (!fan_read_spd(fan, NULL)) {
-        log_log(LOG_L_DEBUG, "Unable to read speed of fan %d", fan->id);
+    tgt = (fan->slew.spd >= 0) ? (int)(fan->slew.spd + 0.5) : fan->spd.tgt;
+    cmd = fan->cmd.spd;
+
+    // Small changes are not worth slow SMC write and make fans hunt, but ends of range are always reached
+    if (cmd >= 0) {
+        if (tgt == cmd)
+            return 1;
+        if (abs(tgt - cmd) < set_get_int(SET_FAN_DEADBAND) && tgt != fan->spd.min && tgt != fan->spd.max)
+            return 1;
+        // Speed goes up right away, but down only after dwell since it last went up
+        if (tgt < cmd && now - fan->cmd.up < set_get_int(SET_FAN_DWELL) * 1000LL)
+            return 1;
+    }
+
+    // Write new fan speed
+    if (!fan->bknd->write_spd(fan, tgt) &&
+        (!fan_recover(fan) || !fan->bknd->write_spd(fan, tgt))) {
+        log_log(LOG_L_DEBUG, "Unable to write speed of fan %d", fan->id);
         return 0;
     }
 
-    // Skip writing speed if already same
-    if (fan->spd.real == fan->spd.tgt)
-        return 1;
+    if (cmd < 0 || tgt > cmd)
+        fan->cmd.up = now;
+    fan->cmd.spd = tgt;
+    fan->cmd.time = now;
+    fan->cmd.writes++;
+
+    return 1;
+}
+
 
-    file = fopen(fan->path.wr, "w+");
-    if (!file) {
-        log_log(LOG_L_DEBUG, "Unable to open output speed file of fan %d", fan->id);
+int fan_slew_spd(t_fan *const fan, const long long now) {
+    double rate = set_get_int(SET_FAN_SLEW);
+    double step = 0;
+    double tgt  = 0;
+
+    if (!fan)
         return 0;
+
+    tgt = fan->spd.tgt;
+
+    // Emergency moves up are not smoothed
+    if (rate <= 0 || (fan->slew.ovr && tgt > fan->slew.spd))
+        fan->slew.spd = tgt;
+    else if (fan->slew.spd < 0)
+        fan->slew.spd = fan_get_spd(fan);
+    else if (fan->slew.time > 0 && now > fan->slew.time) {
+        step = rate * (now - fan->slew.time) / 1000000.0;
+        if (fan->slew.spd < tgt)
+            fan->slew.spd = (fan->slew.spd + step < tgt) ? fan->slew.spd + step : tgt;
+        else
+            fan->slew.spd = (fan->slew.spd - step > tgt) ? fan->slew.spd - step : tgt;
     }
+    // Time spent at target speed must not count into next ramp
+    fan->slew.time = (fan->slew.spd != tgt) ? now : 0;
 
-    // Write new fan speed
-    if (fprintf(file, "%d\n", fan->spd.tgt) < 0) {
-        log_log(LOG_L_DEBUG, "Unable to write speed of fan %d", fan->id);
-        if (fclose(file) == EOF)
-            log_log(LOG_L_DEBUG, "Unable to close output speed file of fan %d", fan->id);
+    return (fan->slew.spd != tgt);
+}
+
+
+int fan_track(t_fan *const fan, const long long now) {
+    enum fan_state state  = FAN_S_OK;
+    enum fan_state prev   = FAN_S_OK;
+    int            cmd    = 0;
+    int            real   = 0;
+    long long      settle = set_get_int(SET_FAN_SETTLE) * 1000LL;
+
+    if (!fan)
         return 0;
+
+    cmd = fan->cmd.spd;
+    real = fan->spd.real;
+    prev = fan->trk.state;
+
+    // Nothing to compare with until speed is commanded
+    if (settle == 0 || cmd < 0) {
+        fan->trk.state = FAN_S_OK;
+        fan->trk.miss = 0;
+        fan->trk.since = 0;
+        return (prev != FAN_S_OK);
+    }
+
+    if (fan->bknd->rpm)
+        fan->trk.err = real - cmd;
+
+    if (cmd > 0 && real < FAN_STALL_RPM)
+        state = FAN_S_STALL;
+    else if (fan->bknd->rpm && real * 100LL < (long long)cmd * (100 - set_get_int(SET_FAN_TOLERANCE)))
+        state = FAN_S_UNDER;
+
+    if (state == FAN_S_OK) {
+        fan->trk.since = 0;
+    } else {
+        if (fan->trk.since == 0)
+            fan->trk.since = now;
+        // Fault has to last for whole settling window, until then previous state holds
+        if (now - fan->trk.since < settle)
+            return 0;
     }
 
-    if (fclose(file) == EOF) {
-        log_log(LOG_L_DEBUG, "Unable to close output speed file of fan %d", fan->id);
+    fan->trk.state = state;
+    if (state == FAN_S_STALL)
+        fan->trk.miss = 1;
+    else if (state == FAN_S_UNDER && fan->spd.max > fan->spd.min)
+        fan->trk.miss = min(cmd - real, fan->spd.max - fan->spd.min) / (double)(fan->spd.max - fan->spd.min);
+    else
+        fan->trk.miss = 0;
+
+    if (state == prev)
         return 0;
+
+    if (state == FAN_S_OK)
+        log_log(LOG_L_INFO, "Fan %d reaches commanded speed again", fan->id);
+    else {
+        if (prev == FAN_S_OK)
+            fan->trk.faults++;
+        log_log(LOG_L_WARN, "Fan %d %s (commanded %d %s, real %d RPM), raising other fans of its zones", fan->id,
+                (state == FAN_S_STALL) ? "stalled" : "is underspeed", cmd, fan->bknd->unit, real);
     }
 
     return 1;
 }
 
 
+const char *fan_get_state(const t_fan *const fan) {
+    switch (fan->trk.state) {
+        case FAN_S_UNDER:
+            return "underspeed";
+        case FAN_S_STALL:
+            return "stalled";
+        default:
+            return "ok";
+    }
+}
+
+
+int fan_get_spd(const t_fan *const fan) {
+    if (fan->cmd.spd >= 0)
+        return fan->cmd.spd;
+
+    // Real speed can stand in only when it is in the same units
+    return (fan->bknd->rpm) ? fan->spd.real : fan->spd.max;
+}
+
+
+double fan_get_writes(const t_fan *const fan, const long long now) {
+    if (!fan || now <= fan->cmd.start)
+        return 0;
+
+    return fan->cmd.writes * 3600000000.0 / (now - fan->cmd.start);
+}
+
+
 void fan_free(t_fan *fan, int self) {
     if (!fan)
         return;
 
+    hnd_close(&(fan->hnd.rd));
+    hnd_close(&(fan->hnd.wr));
+    hnd_close(&(fan->hnd.mod));
+
     if (fan->lbl)
         free(fan->lbl);
     if (fan->path.rd)
@@ -368,6 +433,10 @@ void fan_free(t_fan *fan, int self) {
         free(fan->path.min);
     if (fan->path.max)
         free(fan->path.max);
+    if (fan->path.dev)
+        free(fan->path.dev);
+    if (fan->crv.rise)
+        free(fan->crv.rise);
 
     if (self)
         free(fan);
@@ -378,11 +447,13 @@ void fan_print(const t_fan *const fan, FILE *const file) {
     if (!fan || !file)
         return;
 
-    fprintf(file, "Fan %d - %s\n", fan->id, fan->lbl);
-    fprintf(file, "Min speed: %d    Max speed: %d    Step: %d\n", fan->spd.min, fan->spd.max, fan->spd.step);
+    fprintf(file, "Fan %d - %s (%s)\n", fan->id, fan->lbl, fan->bknd->name);
+    fprintf(file, "Min speed: %d %s    Max speed: %d %s\n", fan->spd.min, fan->bknd->unit, fan->spd.max,
+            fan->bknd->unit);
     fprintf(file, "Read: %s\n", fan->path.rd);
     fprintf(file, "Write: %s\n", fan->path.wr);
     fprintf(file, "Mode: %s\n", fan->path.mod);
-    fprintf(file, "Min: %s\n", fan->path.min);
-    fprintf(file, "Max: %s\n", fan->path.max);
+    fprintf(file, "Min: %s\n", (fan->path.min) ? fan->path.min : "-");
+    fprintf(file, "Max: %s\n", (fan->path.max) ? fan->path.max : "-");
+    fprintf(file, "Device: %s\n", (fan->path.dev) ? fan->path.dev : "-");
 }
\ No newline at end of file
@@ -11,26 +11,30 @@
 #define MACFAND_FAN_H_qwewqiorhq
 
 #include <stdio.h>
+#include <stdint.h>
 
 #include "linked.h"
+#include "handle.h"
 
 /**
  * @brief Fan speeds struct.
  * Struct holding all speeds of fan, which are min, max, real (current)
- * target when changing speed and step (all in RPM, dictated by applesmc).
+ * and target when changing speed. Real speed is in RPM, others are in speed
+ * units of fan backend (RPM for applesmc).
  */
 struct fan_spd {
     int min;
     int max;
     int real;
     int tgt;
-    int step;
 };
 
 /**
  * @brief Fan paths struct.
  * Struct holding all used paths of fan, which are rd for reading,
- * wr for writing and mod for setting mode (auto/manual).
+ * wr for writing, mod for setting mode (auto/manual), min and max
+ * speed (NULL when backend has none) and dev of device fan lives on
+ * (relative to sysfs root, as in uevents).
  */
 struct fan_path {
     char *rd;
@@ -38,17 +42,101 @@ struct fan_path {
     char *mod;
     char *min;
     char *max;
+    char *dev;
+};
+
+/**
+ * @brief Fan handles struct.
+ * Struct holding handles kept open for the whole run of macfand, which are rd for reading,
+ * wr for writing and mod for setting mode (auto/manual).
+ */
+struct fan_hnd {
+    t_hnd rd;
+    t_hnd wr;
+    t_hnd mod;
+};
+
+/**
+ * @brief Fan curve struct.
+ * Struct holding rising and falling branch of speed lookup table of fan (in RPM) indexed by temperature
+ * (see curve.h). Both branches share one allocation starting at rise.
+ */
+struct fan_crv {
+    uint16_t *rise;
+    uint16_t *fall;
+};
+
+/**
+ * @brief Fan command struct.
+ * Struct holding last speed commanded to fan (in RPM, -1 when next target has to be written), time it was
+ * commanded, time speed was last commanded up, number of speed writes and time counting of writes started
+ * (all times in microseconds, time_mono_us()).
+ */
+struct fan_cmd {
+    int       spd;
+    long long time;
+    long long up;
+    long long writes;
+    long long start;
+};
+
+/**
+ * @brief Fan slew struct.
+ * Struct holding speed limited by slew rate on its way to target speed (in RPM, -1 before first step), time
+ * of its last step (in microseconds, time_mono_us(), 0 while not ramping) and whether target speed is max speed
+ * forced by override (raised alarm, CPU throttling or temp_max), which is reached without slew.
+ */
+struct fan_slew {
+    double    spd;
+    long long time;
+    int       ovr;
+};
+
+/**
+ * @brief Enum holding fan tracking states.
+ * Enum holding states of fan found by comparing its real speed with commanded one, which are ok, underspeed
+ * (real speed too low) and stall (fan does not spin).
+ */
+enum fan_state {
+    FAN_S_OK,
+    FAN_S_UNDER,
+    FAN_S_STALL
+};
+
+/**
+ * @brief Fan tracking struct.
+ * Struct holding tracking state of fan, part of its speed range (0 - 1) fan misses while it is not ok, tracking
+ * error (real minus commanded speed in RPM at last readback, only when backend speeds are RPM), time fault was
+ * first seen (in microseconds, time_mono_us(), 0 when fault is not seen) and number of faults.
+ */
+struct fan_trk {
+    enum fan_state state;
+    double         miss;
+    int            err;
+    long long      since;
+    long long      faults;
 };
 
+struct fan_bknd;
+
 /**
  * @brief Fan type.
- * Type for system fan holding id, label, speeds and paths.
+ * Type for system fan holding id, label, backend driving it, mode fan was in before macfand took control
+ * (restored on exit), speeds, paths, open handles, speed curve, last command, speed limited by slew rate and
+ * tracking of commanded speed.
  */
 typedef struct fan {
-    int             id;
-    char            *lbl;
-    struct fan_spd  spd;
-    struct fan_path path;
+    int                   id;
+    char                  *lbl;
+    const struct fan_bknd *bknd;
+    int                   mod;
+    struct fan_spd        spd;
+    struct fan_path       path;
+    struct fan_hnd        hnd;
+    struct fan_crv        crv;
+    struct fan_cmd        cmd;
+    struct fan_slew       slew;
+    struct fan_trk        trk;
 } t_fan;
 
 /**
@@ -60,15 +148,59 @@ enum fan_mode {
     FAN_M_MAN
 };
 
+/**
+ * @brief Enum holding fan backends.
+ * Enum holding fan backends selectable in settings, which are auto (applesmc when present, generic hwmon pwm
+ * otherwise), applesmc and generic hwmon pwm.
+ */
+enum fan_type {
+    FAN_B_AUTO,
+    FAN_B_SMC,
+    FAN_B_PWM
+};
+
+/**
+ * @brief Fan backend struct.
+ * Struct holding name of backend, unit of its speeds, whether its speeds are RPM (so they can be compared with
+ * real speed) and its operations. Backend discovers its fans into generic linked list (NULL when it has none or
+ * on error, every fan is finished by fan_load()), sets mode of fan (FAN_M_AUTO restores mode fan had before
+ * macfand took control) and writes speed of fan in its units. Real speed (in RPM) is read by every backend from
+ * fan->hnd.rd.
+ */
+struct fan_bknd {
+    const char *name;
+    const char *unit;
+    int        rpm;
+    t_node     *(*load)(void);
+    int        (*write_mod)(t_fan *const fan, const enum fan_mode mod);
+    int        (*write_spd)(t_fan *const fan, const int spd);
+};
+
 /**
  * @brief Constructs linked list of system fans.
- * Constructs generic linked list of unlimited number of system fans. For each fan sets its id, real and target
- * speed to 0, from appropriate system files loads its label, min and max speed. Based on these values 
- * calculates step size of speed adjust for given fan and constructs its read, write and mode setting paths.
+ * Constructs generic linked list of unlimited number of system fans discovered by backend selected by
+ * settings->fan_backend (with auto, applesmc is used when it has any fans and generic hwmon pwm otherwise).
  * @return t_node* NULL on error, pointer to head of generic linked list of system fans otherwise.
  */
 t_node *fans_load(void);
 
+/**
+ * @brief Clears given fan.
+ * Sets all allocated members and handles of given fan to empty values, so it can be filled by backend and
+ * safely freed by fan_free() at any point.
+ * @param[out] fan Pointer to fan.
+ */
+void fan_clear(t_fan *const fan);
+
+/**
+ * @brief Finishes loading of given fan.
+ * Finishes loading of fan whose id, label, backend, mode, speed limits and paths were filled by backend. Sets
+ * real and target speed to 0, resets its command and slew state, compiles its speed curve and opens handles.
+ * @param[in,out] fan Pointer to fan.
+ * @return int 0 on error, 1 on success.
+ */
+int fan_load(t_fan *const fan);
+
 /**
  * @brief Sets mode of all system fans.
  * Sets operating mode (automatic or manual) of all system fans by writing to the appropriate system files.
@@ -78,17 +210,108 @@ t_node *fans_load(void);
  */
 int fans_write_mod(const t_node *fans, const enum fan_mode mod);
 
+/**
+ * @brief Checks whether fans live on given device.
+ * Checks whether any fan lives on device with given path (relative to sysfs root, as in uevents) or on its child.
+ * @param[in] fans Pointer to head of generic linked list of system fans.
+ * @param[in] dev  Path of device.
+ * @return int 0 if no fan lives on device, 1 otherwise.
+ */
+int fans_has_dev(const t_node *fans, const char *const dev);
+
+/**
+ * @brief Recovers fans of given device.
+ * Reopens handles of every fan living on device with given path (see fans_has_dev()) and sets it back to
+ * manual mode. Used when fan device reappears in system.
+ * @param[in,out] fans Pointer to head of generic linked list of system fans.
+ * @param[in]     dev  Path of device.
+ * @return int 0 if at least one recovery failed, 1 on success.
+ */
+int fans_recover(t_node *fans, const char *const dev);
+
+/**
+ * @brief Reads current speed of given fan.
+ * Reads current real speed of given fan into fan->spd.real using its open handle. If fan device
+ * went away, reopens handles of given fan and sets it back to manual mode.
+ * @param[in,out] fan Pointer to fan.
+ * @return int 0 on error, 1 on success.
+ */
+int fan_read_spd(t_fan *const fan);
+
+/**
+ * @brief Reads current speed of all fans.
+ * Reads current real speed of every fan using fan_read_spd().
+ * @param[in,out] fans Pointer to head of generic linked list of system fans.
+ * @return int 0 if at least one reading failed, 1 on success.
+ */
+int fans_read_spd(t_node *fans);
+
 /**
  * @brief Sets speed of given fan.
- * Read current real speed of given fan and sets new speed by writing to the appropriate system file.
+ * Sets speed of given fan limited by slew rate (see fan_slew_spd(), target speed before first step) using its
+ * backend, unless it differs from last commanded speed by less than settings->fan_deadband (min and max speed
+ * are always written) or it is lower than last commanded speed and speed was commanded up less than
+ * settings->fan_dwell ago. If fan device went away, reopens handles of given fan and sets it back to manual mode.
  * @param[in,out] fan Pointer to fan.
  * @return int 0 on error, 1 on success.
  */
 int fan_write_spd(t_fan *const fan);
 
+/**
+ * @brief Moves speed of given fan towards its target.
+ * Moves speed of given fan limited by slew rate towards its target speed by at most settings->fan_slew RPM per
+ * second elapsed since its last step. First step starts from current speed (see fan_get_spd()) and ramp starts
+ * moving on step after target speed changed. Without slew rate (0) or when override raises target speed
+ * (fan->slew.ovr) speed jumps to target speed right away.
+ * @param[in,out] fan Pointer to fan.
+ * @param[in]     now Current time in microseconds (time_mono_us()).
+ * @return int 0 if speed reached target speed, 1 if it is still ramping.
+ */
+int fan_slew_spd(t_fan *const fan, const long long now);
+
+/**
+ * @brief Tracks commanded speed of given fan.
+ * Compares real speed of given fan read back at given time with its commanded speed. Fan which does not spin
+ * although it is commanded to, stalls. Fan which is slower than settings->fan_tolerance percent of commanded
+ * speed is underspeed (only when backend speeds are RPM). Fault has to be seen for settings->fan_settle
+ * milliseconds, so spin up and ramps are not faults, fan is ok again as soon as fault is not seen.
+ * Settling window 0 disables tracking.
+ * @param[in,out] fan Pointer to fan.
+ * @param[in]     now Current time in microseconds (time_mono_us()).
+ * @return int 0 if tracking state did not change, 1 otherwise.
+ */
+int fan_track(t_fan *const fan, const long long now);
+
+/**
+ * @brief Gets name of tracking state.
+ * Gets name of tracking state of given fan.
+ * @param[in] fan Pointer to fan.
+ * @return const char* name of tracking state.
+ */
+const char *fan_get_state(const t_fan *const fan);
+
+/**
+ * @brief Gets current speed of given fan.
+ * Gets last commanded speed of given fan, which is used by control instead of real speed read back only
+ * every settings->fan_readback cycles. Until first speed is commanded, real speed is used when backend speeds
+ * are RPM and max speed otherwise.
+ * @param[in] fan Pointer to fan.
+ * @return int current speed of fan in RPM.
+ */
+int fan_get_spd(const t_fan *const fan);
+
+/**
+ * @brief Gets speed writes per hour.
+ * Gets average number of speed writes of given fan per hour since start.
+ * @param[in] fan Pointer to fan.
+ * @param[in] now Current time in microseconds (time_mono_us()).
+ * @return double speed writes per hour.
+ */
+double fan_get_writes(const t_fan *const fan, const long long now);
+
 /**
  * @brief Frees memory for given fan.
- * Calls free() on all allocated members of given fan if they are not NULL and fan itself 
+ * Closes handles and calls free() on all allocated members of given fan if they are not NULL and fan itself 
  * if self is not 0.
  * @param[in] fan  Pointer to fan.
  * @param[in] self Boolean if the fan itself should be freed.
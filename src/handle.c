@@ -0,0 +1,121 @@
+/**
+ * macfand - hipuranyhou - 16.10.2026
+ *
+ * Daemon for controlling fans on Linux systems using
+ * applesmc and coretemp.
+ *
+ * https://github.com/Hipuranyhou/macfand
+ */
+
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include "handle.h"
+#include "helper.h"
+
+
+int hnd_open(t_hnd *const hnd, const char *const path, const int flags) {
+    if (!hnd)
+        return 0;
+
+    hnd->fd = -1;
+    hnd->flags = flags;
+    hnd->path = path;
+
+    return hnd_reopen(hnd);
+}
+
+
+int hnd_reopen(t_hnd *const hnd) {
+    if (!hnd || !hnd->path)
+        return 0;
+
+    hnd_close(hnd);
+
+    hnd->fd = open(hnd->path, hnd->flags | O_CLOEXEC);
+    if (hnd->fd < 0)
+        return 0;
+
+    return 1;
+}
+
+
+ssize_t hnd_read(t_hnd *const hnd, char *const buf, const size_t buf_size) {
+    ssize_t rd_ret = 0;
+
+    if (!hnd || !buf || buf_size < 2)
+        return -1;
+
+    if (hnd->fd < 0 && !hnd_reopen(hnd))
+        return -1;
+
+    // sysfs regenerates attribute content on every read from offset 0
+    do {
+        rd_ret = pread(hnd->fd, buf, buf_size - 1, 0);
+    } while (rd_ret < 0 && errno == EINTR);
+
+    if (rd_ret < 1) {
+        hnd_close(hnd);
+        return -1;
+    }
+
+    buf[rd_ret] = '\0';
+    return rd_ret;
+}
+
+
+int hnd_parse_int(const char *const buf, const ssize_t len, int *const dest) {
+    if (len < 1)
+        return 0;
+
+    return sysfs_to_int(buf, len, dest);
+}
+
+
+int hnd_read_int(t_hnd *const hnd, int *const dest) {
+    char    buf[HND_BUF_SIZE];
+    ssize_t rd_ret = 0;
+
+    rd_ret = hnd_read(hnd, buf, sizeof(buf));
+
+    return hnd_parse_int(buf, rd_ret, dest);
+}
+
+
+int hnd_write_int(t_hnd *const hnd, const int val) {
+    char    buf[HND_BUF_SIZE];
+    int     len    = 0;
+    ssize_t wr_ret = 0;
+
+    if (!hnd)
+        return 0;
+
+    len = snprintf(buf, sizeof(buf), "%d\n", val);
+    if (len < 2 || (size_t)len >= sizeof(buf))
+        return 0;
+
+    if (hnd->fd < 0 && !hnd_reopen(hnd))
+        return 0;
+
+    do {
+        wr_ret = pwrite(hnd->fd, buf, len, 0);
+    } while (wr_ret < 0 && errno == EINTR);
+
+    if (wr_ret != len) {
+        hnd_close(hnd);
+        return 0;
+    }
+
+    return 1;
+}
+
+
+void hnd_close(t_hnd *const hnd) {
+    if (!hnd || hnd->fd < 0)
+        return;
+
+    close(hnd->fd);
+    hnd->fd = -1;
+}
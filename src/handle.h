@@ -0,0 +1,94 @@
+/**
+ * macfand - hipuranyhou - 16.10.2026
+ *
+ * Daemon for controlling fans on Linux systems using
+ * applesmc and coretemp.
+ *
+ * https://github.com/Hipuranyhou/macfand
+ */
+
+#ifndef MACFAND_HANDLE_H_zuqopwnvlx
+#define MACFAND_HANDLE_H_zuqopwnvlx
+
+#include <sys/types.h>
+
+#define HND_BUF_SIZE 32
+
+/**
+ * @brief Persistent sysfs file handle.
+ * Type holding file descriptor of sysfs attribute kept open between reads, flags used to open it
+ * and path of the attribute (not owned by handle). Descriptor is -1 when handle is closed.
+ */
+typedef struct hnd {
+    int        fd;
+    int        flags;
+    const char *path;
+} t_hnd;
+
+/**
+ * @brief Initializes handle and opens it.
+ * Initializes given handle with path and open flags and opens it. Path is not copied, so it has
+ * to outlive the handle. Even on error handle is initialized and can be reopened later.
+ * @param[out] hnd   Pointer to handle.
+ * @param[in]  path  Path to sysfs attribute.
+ * @param[in]  flags Flags passed to open() (O_CLOEXEC is always added).
+ * @return int 0 on error, 1 on success.
+ */
+int hnd_open(t_hnd *const hnd, const char *const path, const int flags);
+
+/**
+ * @brief Reopens given handle.
+ * Closes descriptor of given handle if it is open and opens its path again.
+ * @param[in,out] hnd Pointer to handle.
+ * @return int 0 on error, 1 on success.
+ */
+int hnd_reopen(t_hnd *const hnd);
+
+/**
+ * @brief Reads content of attribute from the beginning.
+ * Reads content of attribute using pread() at offset 0 into given buffer and terminates it with null byte.
+ * Closed handle is reopened first. On error descriptor is closed, so next call reopens it.
+ * @param[in,out] hnd      Pointer to handle.
+ * @param[out]    buf      Destination buffer.
+ * @param[in]     buf_size Size of destination buffer.
+ * @return ssize_t -1 on error, number of read bytes otherwise.
+ */
+ssize_t hnd_read(t_hnd *const hnd, char *const buf, const size_t buf_size);
+
+/**
+ * @brief Parses integer value of attribute.
+ * Parses integer value read from attribute into given buffer using sysfs_to_int().
+ * @param[in]  buf  Buffer holding read value.
+ * @param[in]  len  Number of read bytes in buffer (negative on failed read).
+ * @param[out] dest Address of destination.
+ * @return int 0 on error, 1 on success.
+ */
+int hnd_parse_int(const char *const buf, const ssize_t len, int *const dest);
+
+/**
+ * @brief Reads integer value of attribute.
+ * Reads integer value of attribute using hnd_read() into stack buffer without allocating memory.
+ * @param[in,out] hnd  Pointer to handle.
+ * @param[out]    dest Address of destination.
+ * @return int 0 on error, 1 on success.
+ */
+int hnd_read_int(t_hnd *const hnd, int *const dest);
+
+/**
+ * @brief Writes integer value to attribute.
+ * Formats given integer followed by newline into stack buffer and writes it using pwrite() at offset 0.
+ * Closed handle is reopened first. On error descriptor is closed, so next call reopens it.
+ * @param[in,out] hnd Pointer to handle.
+ * @param[in]     val Value to be written.
+ * @return int 0 on error, 1 on success.
+ */
+int hnd_write_int(t_hnd *const hnd, const int val);
+
+/**
+ * @brief Closes given handle.
+ * Closes descriptor of given handle if it is open.
+ * @param[in,out] hnd Pointer to handle.
+ */
+void hnd_close(t_hnd *const hnd);
+
+#endif //MACFAND_HANDLE_H_zuqopwnvlx
@@ -12,6 +12,7 @@
 #include <errno.h>
 #include <limits.h>
 #include <ctype.h>
+#include <time.h>
 
 #include "helper.h"
 
@@ -126,6 +127,60 @@ int str_to_int(const char *const str, int *const dest, int base, char *const inv
 }
 
 
+int str_to_dbl(const char *const str, double *const dest) {
+    double d    = 0;
+    char   *end = NULL;
+
+    if (!str || !dest || (!isdigit(*str) && *str != '-' && *str != '.'))
+        return 0;
+
+    errno = 0;
+    d = strtod(str, &end);
+
+    if (errno == ERANGE || end == str || *end != '\0')
+        return 0;
+
+    *dest = d;
+    return 1;
+}
+
+
+int sysfs_to_int(const char *const buf, size_t len, int *const dest) {
+    const char   *end = NULL;
+    const char   *str = buf;
+    unsigned int lim  = INT_MAX;
+    unsigned int val  = 0;
+    unsigned int dig  = 0;
+
+    if (!buf || !dest)
+        return 0;
+
+    // Ignore trailing '\n'
+    if (len > 0 && buf[len-1] == '\n')
+        len--;
+    end = buf + len;
+
+    if (str < end && *str == '-') {
+        lim = (unsigned int)INT_MAX + 1;
+        str++;
+    }
+
+    if (str == end)
+        return 0;
+
+    while (str < end) {
+        dig = (unsigned char)*str - '0';
+        if (dig > 9 || val > (lim - dig) / 10)
+            return 0;
+        val = val * 10 + dig;
+        str++;
+    }
+
+    *dest = (lim > INT_MAX) ? (int)(0U - val) : (int)val;
+    return 1;
+}
+
+
 void free_dirent_names(struct dirent **names, int n) {
     if (!names)
         return;
@@ -137,6 +192,16 @@ void free_dirent_names(struct dirent **names, int n) {
 }
 
 
+long long time_mono_us(void) {
+    struct timespec ts;
+
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) < 0)
+        return -1;
+
+    return (long long)ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+
 int max(const int a, const int b) {
     return (a > b) ? a : b;
 }
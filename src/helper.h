@@ -57,6 +57,27 @@ ssize_t get_str_until(const char *str, const char delim, char **dest, size_t *co
  */
 int str_to_int(const char *const str, int *const dest, int base, char *const inv);
 
+/**
+ * @brief Converts string to double
+ * Converts given string to double using strtod(). Whole string has to be converted.
+ * Final double is saved in *dest.
+ * @param[in]  str  String from which we extract number.
+ * @param[out] dest Address of destination.
+ * @return int 0 on error, 1 on success
+ */
+int str_to_dbl(const char *const str, double *const dest);
+
+/**
+ * @brief Converts content of sysfs attribute to integer.
+ * Converts decimal integer read from sysfs attribute into *dest without allocating memory and without
+ * need of null byte. Optional leading '-' and one trailing newline are accepted, anything else is rejected.
+ * @param[in]  buf  Buffer holding content of attribute.
+ * @param[in]  len  Number of valid bytes in buffer.
+ * @param[out] dest Address of destination.
+ * @return int 0 on error, 1 on success.
+ */
+int sysfs_to_int(const char *const buf, size_t len, int *const dest);
+
 /**
  * @brief Frees all remaining member returned by scandir().
  * Frees all remaining member returned by scandir().
@@ -65,6 +86,13 @@ int str_to_int(const char *const str, int *const dest, int base, char *const inv
  */
 void free_dirent_names(struct dirent **names, int n);
 
+/**
+ * @brief Gets current monotonic time.
+ * Gets current time of CLOCK_MONOTONIC in microseconds.
+ * @return long long -1 on error, current monotonic time in microseconds otherwise.
+ */
+long long time_mono_us(void);
+
 /**
  * @brief Returns max of two given integers.
  * Returns max of two given integers.
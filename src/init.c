@@ -8,7 +8,6 @@
  */
 
 #include <argp.h>
-#include <signal.h>
 #include <string.h>
 
 #include "init.h"
@@ -20,6 +19,8 @@
 #include "daemonize.h"
 #include "control.h"
 #include "config.h"
+#include "sweep.h"
+#include "event.h"
 
 /**
  * @brief Struct used for argp.
@@ -39,44 +40,23 @@ struct args {
 static int init_set(const struct args *const args);
 
 /**
- * @brief Sets the termination flag.
- * Sets the termination flag to sig for exiting out of main control loop when termination signal is catched.
- * @param[in] sig Catched signal number.
- */
-static void set_term_flag(int sig);
-
-/**
- * @brief Sets the reload config flag.
- * Sets the reload config flag to sig for reloading config in main control loop when SIGHUP is catched.
- * @param[in] sig Catched signal number.
- */
-static void set_rld_flag(int sig);
-
-/**
- * @brief Wrapper for all sigaction() calls.
- * Wrapper for all sigaction() calls for all signals we want to register.
- * @return int 0 on error, 1 on success.
- */
-static int init_sig(void);
-
-/**
- * @brief Prepares generic linked lists of monitors and fans for use.
- * Used to load generic linked lists of monitors and fans for use. Loads max temperature 
- * into settings and sets fans to automatic mode. Logs error messages and both lists using logger.
- * @param[in,out] mons Pointer to head of linked list of temperature monitors.
+ * @brief Prepares table of monitors and generic linked list of fans for use.
+ * Used to load table of monitors and generic linked list of fans for use. Loads max temperature 
+ * into settings and sets fans to automatic mode. Logs error messages, monitors and fans using logger.
+ * @param[in,out] mons Pointer to table of temperature monitors.
  * @param[in,out] fans Pointer to head of linked list of system fans.
  * @return int 0 on error, 1 on success
  */
-static int init_mons_fans(t_node **mons, t_node **fans);
+static int init_mons_fans(t_mons **mons, t_node **fans);
 
 /**
  * @brief Frees all allocated memory and logs exit.
- * Used in main() before exit. Frees memory used by lists mons and fans, resets fans to 
+ * Used in main() before exit. Frees memory used by table mons and list fans, resets fans to 
  * automatic mode, frees string settings and prepares logger for exit.
- * @param[in,out] mons Pointer to head of linked list of temperature monitors.
+ * @param[in,out] mons Pointer to table of temperature monitors.
  * @param[in,out] fans Pointer to head of linked list of system fans.
  */
-static void init_exit(t_node *mons, t_node *fans);
+static void init_exit(t_mons *mons, t_node *fans);
 
 
 static int init_set(const struct args *const args) {
@@ -103,57 +83,31 @@ static int init_set(const struct args *const args) {
 }
 
 
-extern volatile sig_atomic_t term_flag;
-extern volatile sig_atomic_t rld_flag;
-
-
-static void set_term_flag(int sig) {
-    term_flag = sig;
-}
-
-
-static void set_rld_flag(int sig) {
-    rld_flag = sig;
-}
-
-
-static int init_sig(void) {
-    struct sigaction action;
+static int init_mons_fans(t_mons **mons, t_node **fans) {
+    int temp_max = 0;
+    int temp_def = 0;
 
-    action.sa_flags = 0;
-    if (sigemptyset(&action.sa_mask) < 0)
-        return 0;
-
-    // Prepare all signals after which we terminate
-    action.sa_handler = set_term_flag;
-    if (sigaction(SIGABRT, &action, NULL) < 0 ||
-        sigaction(SIGINT, &action, NULL) < 0  ||
-        sigaction(SIGQUIT, &action, NULL) < 0 ||
-        sigaction(SIGTERM, &action, NULL) < 0)
-        return 0;
-
-    // Reload config action
-    action.sa_handler = set_rld_flag;
-    if (sigaction(SIGHUP, &action, NULL) < 0)
-        return 0;
-
-    return 1;
-}
-
-
-static int init_mons_fans(t_node **mons, t_node **fans) {
     // Temperature monitors
     *mons = mons_load();
     if (!(*mons)) {
         log_log(LOG_L_ERROR, "Unable to load system temperature monitors");
         return 0;
     }
-    if (!set_set_int(SET_TEMP_MAX, mons_read_temp_max(*mons))) {
+    temp_max = mons_read_temp_max(*mons);
+    temp_def = set_get_int(SET_TEMP_MAX);
+    if (temp_max < 0)
+        log_log(LOG_L_WARN, "No monitor reports max temperature, using %d°C", temp_def);
+    else if (!set_set_int(SET_TEMP_MAX, temp_max)) {
         log_log(LOG_L_ERROR, "Unable to load max temperature");
         return 0;
+    } else if (!set_check()) {
+        // Chip with low max (nvme, drivetemp, ...) must not push temp_max under temp_high or controller targets
+        set_set_int(SET_TEMP_MAX, temp_def);
+        log_log(LOG_L_WARN, "Max temperature %d°C of monitors is not above temp_high, pid_target and mpc_ceiling, "
+                "using %d°C", temp_max, temp_def);
     }
     if (set_get_int(SET_VERBOSE))
-        log_log_list("monitors", *mons, (void (*)(const void *, FILE *const))mon_print);
+        log_log_data("monitors", *mons, (void (*)(const void *, FILE *const))mons_print);
 
     // Fans
     *fans = fans_load();
@@ -168,13 +122,21 @@ static int init_mons_fans(t_node **mons, t_node **fans) {
         return 0;
     }
 
+    // Reading backend
+    if (!swp_init(*mons, *fans)) {
+        log_log(LOG_L_ERROR, "Unable to prepare reading of monitors and fans");
+        return 0;
+    }
+
     return 1;
 }
 
 
-void init_exit(t_node *mons, t_node *fans) {
+void init_exit(t_mons *mons, t_node *fans) {
+    swp_exit();
+
     if (mons)
-        list_free(mons, (void (*)(void *, int))mon_free);
+        mons_free(mons);
 
     if (fans) {
         if (!fans_write_mod(fans, FAN_M_AUTO))
@@ -225,7 +187,7 @@ static struct argp argp = {options, parse_opt, NULL, NULL, NULL, NULL, NULL};
 
 
 int init_load(int argc, char **argv) {
-    t_node      *mons  = NULL;
+    t_mons      *mons  = NULL;
     t_node      *fans  = NULL;
     struct args args   = {
         .no_conf = 0,
@@ -234,14 +196,22 @@ int init_load(int argc, char **argv) {
     // Argp leaking memory on failure?
     argp_parse(&argp, argc, argv, 0, NULL, &args);
 
+    // Configuration file is reloaded on top of defaults with command line overrides
+    if (!set_base_save()) {
+        log_log(LOG_L_ERROR, "Unable to save default settings.");
+        init_exit(mons, fans);
+        return 0;
+    }
+
     // Load settings
     if (!init_set(&args)) {
         init_exit(mons, fans);
         return 0;
     }
 
-    if (!init_sig()) {
-        log_log(LOG_L_ERROR, "Unable to register signal handlers.");
+    // Signals are read only by event loop, ones sent before it starts stay pending
+    if (!evt_block_sig()) {
+        log_log(LOG_L_ERROR, "Unable to block signals.");
         init_exit(mons, fans);
         return 0;
     }
@@ -12,7 +12,7 @@
 
 /**
  * @brief Prepares and start macfand.
- * Parses command line arguments using argp, registers signal handlers, loads and checks settings, 
+ * Parses command line arguments using argp, blocks signals read by event loop, loads and checks settings, 
  * sets fans to manual mode and starts main control loop. Sets fans back to automatic mode when exiting.
  * @param[in] argc Number of command line arguments.
  * @param[in] argv Passed command line arguments.
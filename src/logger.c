@@ -258,6 +258,29 @@ void log_log_list(const char *const name, const t_node *head, void (*node_print)
 }
 
 
+void log_log_data(const char *const name, const void *const data, void (*data_print)(const void *const, FILE *const)) {
+    FILE *file = NULL;
+
+    log_log(LOG_L_INFO, "Currently loaded %s ->\n", name);
+
+    switch (logger.type) {
+        case LOG_T_STD:
+            file = stdout;
+            break;
+        case LOG_T_SYS:
+            return;
+        case LOG_T_FILE:
+            file = logger.file;
+            break;
+        default:
+            return;
+    }
+
+    data_print(data, file);
+    fflush(file);
+}
+
+
 void log_exit(void) {
     log_log(LOG_L_INFO, "Shutting down");
     // Here, as logger, we cannot really do much with I/O errors
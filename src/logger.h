@@ -66,6 +66,16 @@ void log_log(int lvl, const char *const fmt, ...);
  */
 void log_log_list(const char *const name, const t_node *head, void (*node_print)(const void *const, FILE *const));
 
+/**
+ * @brief Logs given data.
+ * Logs given data using given print function based on logger type (file or std).
+ * Printing of data is disabled when using syslog.
+ * @param[in] name       Name of logged data.
+ * @param[in] data       Pointer to logged data.
+ * @param[in] data_print Pointer to print function for type of logged data.
+ */
+void log_log_data(const char *const name, const void *const data, void (*data_print)(const void *const, FILE *const));
+
 /**
  * @brief Logs exit message and gracefully exits logger
  * Logs exit message, and closes open log file and syslog if used.
@@ -12,396 +12,1298 @@
 #include <string.h>
 #include <errno.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <ctype.h>
 
 #include "monitor.h"
 #include "helper.h"
 #include "settings.h"
 #include "logger.h"
 
-#define MON_PATH_CLS  "/sys/class/hwmon"
-#define MON_PATH_BASE "/sys/devices/platform/coretemp.0/hwmon"
-#define MON_PATH_RD   "input"
-#define MON_PATH_MAX  "max"
-#define MON_PATH_LBL  "label"
-#define MON_PATH_FMT  MON_PATH_BASE "/hwmon%d/temp%d_%s"
+#define MON_PATH_CLS       "/class/hwmon"
+#define MON_PATH_RD        "input"
+#define MON_PATH_MAX       "max"
+#define MON_PATH_CRIT      "crit"
+#define MON_PATH_LBL       "label"
+#define MON_PATH_ALRM_MAX  "max_alarm"
+#define MON_PATH_ALRM_CRIT "crit_alarm"
+#define MON_PATH_CLS_FMT   "%s" MON_PATH_CLS "/hwmon%d"
+#define MON_PATH_NAME      "%s" MON_PATH_CLS "/hwmon%d/name"
+#define MON_PATH_FMT       "%s" MON_PATH_CLS "/hwmon%d/temp%d_%s"
+#define MON_PATH_CPU       "/devices/system/cpu"
+#define MON_PATH_THR_FMT   "%s" MON_PATH_CPU "/cpu%d/thermal_throttle/%s_throttle_count"
+#define MON_PATH_TOPO_FMT  "%s" MON_PATH_CPU "/cpu%d/topology/%s"
+
+#define MON_ARR_CNT     6
+#define MON_BACKOFF_MAX 6
+#define MON_STUCK_TIME  600000000LL
+#define MON_VALID_MIN   0
+#define MON_VALID_MAX   150000
 
 /**
  * @brief Loads label of given temperature monitor.
- * Loads label of given temperature monitor into mon->lbl by reading appropriate system file.
- * @param[in,out] mon Monitor to be updated.
+ * Loads label of given temperature monitor into info->lbl by reading appropriate system file.
+ * @param[in,out] info Information about monitor to be updated.
  * @return int 0 on error, 1 on success.
  */
-static int mon_load_lbl(t_mon *const mon);
+static int mon_load_lbl(struct mon_info *const info);
 
 /**
- * @brief Selects where should monitor read temperature end and from where should be read.
- * Changes *dest to proper location of where should be temperature saved after reading and *path
- * to from where should temperature for given monitors be read based on path suffix.
- * @param[in]  mon  Monitor which temperature we read.
- * @param[in]  suff Suffix of temperature file from which we read temperature.
- * @param[out] dest Pointer where should be read value destination saved.
- * @param[out] path Pointer where should be read path saved.
- * @return int 0 on error, 1 on success
+ * @brief Loads max temperature of given monitor.
+ * Loads max temperature of given monitor into *max by reading appropriate system file. Falls back
+ * to crit temperature, max is set to 0 when none of them is known.
+ * @param[in,out] info Information about monitor.
+ * @param[out]    max  Address of destination.
+ * @return int 0 on error, 1 on success.
  */
-static int mon_sel_temp_dest(t_mon *const mon, const char *const suff, int **const dest, char **const path);
+static int mon_load_max(struct mon_info *const info, int *const max);
 
 /**
- * @brief Loads temperature of given monitor.
- * If suff is NULL, reads current temperature of monitor into mon->temp.real. If suff is 
- * MON_PATH_MAX, reads max temperature of given monitor into mon->temp.max.
- * @param[in,out] mon  Monitor to be updated.
- * @param[in]     suff Suffix of temperature file from which we read temperature.
+ * @brief Loads defaults of given monitor.
+ * Loads read path, max path and label of given monitor.
+ * @param[in,out] info Information about monitor to be updated.
  * @return int 0 on error, 1 on success.
  */
-static int mon_read_temp(t_mon *const mon, const char *const suff);
+static int mon_load_def(struct mon_info *const info);
 
 /**
- * @brief Loads defaults of given monitor.
- * Loads label, read path, max temperature and sets real temperature to 0.
- * @param[in,out] mon Monitor to be updated.
- * @return int 0 on error, 1 on success.
+ * @brief Frees memory for information about monitor.
+ * Calls free() on members of information about monitor if they are not NULL.
+ * @param[in] info Information about monitor.
  */
-static int mon_load_def(t_mon *const mon);
+static void mon_info_free(struct mon_info *const info);
 
 /**
- * @brief Finds hwmon id of coretemp.0.
- * Finds hwmon id of coretemp.0 using symlink in /sys/class/hwmon.
- * @return int -1 on error, coretemp.0 hwmon entry id otherwise.
+ * @brief Filters out files which are not temperature inputs.
+ * Filters out files not starting filename with "temp" or not ending it with "_input" when using scandir().
+ * @param[in] dirent Pointer to dirent entry which filename we check.
+ * @return int 0 on not temperature input, 1 on temperature input.
  */
-static int mons_find_hw_id(void);
+static int mons_load_filter(const struct dirent *dirent);
 
 /**
- * @brief Filters out files not starting filename with "temp".
- * Filters out files not starting filename with "temp" when using scandir().
+ * @brief Filters out entries of hwmon class not starting filename with "hwmon".
+ * Filters out entries of hwmon class not starting filename with "hwmon" when using scandir().
  * @param[in] dirent Pointer to dirent entry which filename we check.
  * @return int 0 on not starting, 1 on starting.
  */
-static int mons_load_filter(const struct dirent *dirent);
+static int mons_load_hw_filter(const struct dirent *dirent);
+
+/**
+ * @brief Compares hwmon entries by their id.
+ * Compares hwmon entries by number following "hwmon" in their filename, so hwmon10 comes after hwmon2.
+ * @param[in] a Pointer to first dirent entry.
+ * @param[in] b Pointer to second dirent entry.
+ * @return int Negative, zero or positive if a is lower, same or higher than b.
+ */
+static int mons_load_hw_cmp(const struct dirent **a, const struct dirent **b);
+
+/**
+ * @brief Loads name of chip behind hwmon entry.
+ * Loads name of chip (coretemp, nvme, k10temp, ...) behind given hwmon entry into given buffer.
+ * @param[in]  hw        Id of hwmon entry.
+ * @param[out] name      Destination buffer.
+ * @param[in]  name_size Size of destination buffer.
+ * @return int 0 on error, 1 on success.
+ */
+static int mons_load_name(const int hw, char *const name, const size_t name_size);
+
+/**
+ * @brief Loads device of chip behind hwmon entry.
+ * Loads path of device behind given hwmon entry relative to sysfs root (/devices/platform/coretemp.0, ...),
+ * which does not change when hwmon entries are renumbered.
+ * @param[in] hw Id of hwmon entry.
+ * @return char* NULL on error, path of device otherwise (has to be freed).
+ */
+static char *mons_load_dev(const int hw);
+
+/**
+ * @brief Scans directory under sysfs root.
+ * Scans directory at given path relative to settings->sysfs_root using scandir().
+ * @param[in]  dir    Path of directory relative to sysfs root.
+ * @param[out] names  Address of array of entries (see scandir()).
+ * @param[in]  filter Filter of entries (see scandir()).
+ * @param[in]  cmp    Comparison of entries (see scandir()).
+ * @return int -1 on error, number of entries otherwise.
+ */
+static int mons_scan(const char *const dir, struct dirent ***names, int (*filter)(const struct dirent *),
+                     int (*cmp)(const struct dirent **, const struct dirent **));
+
+/**
+ * @brief Checks whether given chip is selected as sensor source.
+ * Checks whether given chip is selected by comma separated list of sensor sources in settings. Source
+ * is either "all", chip name selecting all chips with this name or chip name followed by '.' and its index.
+ * @param[in] name Name of chip.
+ * @param[in] id   Index of chip amongst chips with the same name.
+ * @return int 0 on not selected, 1 on selected.
+ */
+static int mons_sel_chip(const char *const name, const int id);
+
+/**
+ * @brief Loads all temperature monitors of given chip.
+ * Loads information about all temperature monitors of given chip and appends them to information
+ * array of given table, which is resized when needed.
+ * @param[in,out] mons Pointer to table of temperature monitors.
+ * @param[in,out] cap  Address of capacity of information array.
+ * @param[in]     hw   Id of hwmon entry of chip.
+ * @param[in]     name Name of chip.
+ * @param[in]     id   Index of chip amongst chips with the same name.
+ * @return int 0 on error, 1 on success.
+ */
+static int mons_load_chip(t_mons *const mons, int *const cap, const int hw, const char *const name, const int id);
+
+/**
+ * @brief Allocates and fills arrays of table.
+ * Allocates temperature, max, flags and health arrays of given table as one block and handles array, loads
+ * max temperature and opens reading handle of every monitor.
+ * @param[in,out] mons Pointer to table of temperature monitors with loaded information array.
+ * @return int 0 on error, 1 on success.
+ */
+static int mons_load_tbl(t_mons *const mons);
+
+/**
+ * @brief Opens alarm files of all monitors.
+ * Opens max and crit alarm files of every monitor which provides them and reads their initial state,
+ * so they can be waited for using poll() with POLLPRI.
+ * @param[in,out] mons Pointer to table of temperature monitors.
+ * @return int 0 on error, 1 on success.
+ */
+static int mons_load_alrm(t_mons *const mons);
+
+/**
+ * @brief Filters out entries not being CPU.
+ * Filters out entries of CPU directory not starting filename with "cpu" followed by digit when using scandir().
+ * @param[in] dirent Pointer to dirent entry which filename we check.
+ * @return int 0 on not CPU, 1 on CPU.
+ */
+static int mons_load_cpu_filter(const struct dirent *dirent);
+
+/**
+ * @brief Reads topology attribute of CPU.
+ * Reads first integer of given topology attribute (physical_package_id, thread_siblings_list, ...) of CPU
+ * with given index.
+ * @param[in] cpu  Index of CPU.
+ * @param[in] attr Name of topology attribute.
+ * @return int -1 on error, first integer of attribute otherwise.
+ */
+static int mons_load_topo(const int cpu, const char *const attr);
+
+/**
+ * @brief Opens throttle counter.
+ * Opens throttle counter of given kind (core or package) of CPU with given index, reads its current value
+ * and adds it to throttle counters of given table.
+ * @param[in,out] mons Pointer to table of temperature monitors.
+ * @param[in]     cpu  Index of CPU.
+ * @param[in]     kind Kind of counter (one of enum mon_thr_kind).
+ * @return int 0 if counter does not exist (or on error), 1 on success.
+ */
+static int mons_load_thr_cnt(t_mons *const mons, const int cpu, const int kind);
 
+/**
+ * @brief Loads throttle counters.
+ * Opens thermal throttle counters of all CPUs. Counters shared by hardware threads of one core (or by CPUs
+ * of one package) are opened only once. CPUs without thermal_throttle (non-Intel) leave table without counters.
+ * @param[in,out] mons Pointer to table of temperature monitors.
+ * @return int 0 on error, 1 on success.
+ */
+static int mons_load_thr(t_mons *const mons);
+
+/**
+ * @brief Gets index of chip.
+ * Gets index of hwmon chip with given index and name amongst chips with the same name (ordered by hwmon index).
+ * @param[in] hw   Index of hwmon chip.
+ * @param[in] name Name of chip.
+ * @return int -1 on error, index of chip otherwise.
+ */
+static int mons_load_id(const int hw, const char *const name);
 
-static int mon_load_lbl(t_mon *const mon) {
+/**
+ * @brief Opens alarm of monitor.
+ * Opens alarm file of given alarm slot using current hwmon index of its monitor.
+ * @param[in,out] mons Pointer to table of temperature monitors.
+ * @param[in]     i    Index of alarm.
+ * @return int 0 if alarm file does not exist (or on error), 1 on success.
+ */
+static int mons_open_alrm(t_mons *const mons, const int i);
+
+/**
+ * @brief Attaches monitor to chip.
+ * Attaches gone monitor to hwmon chip with given index by rebuilding its paths and reopening its handles
+ * and alarms.
+ * @param[in,out] mons Pointer to table of temperature monitors.
+ * @param[in]     i    Index of monitor.
+ * @param[in]     hw   Index of hwmon chip.
+ * @return int 0 on error, 1 on success.
+ */
+static int mons_attach(t_mons *const mons, const int i, const int hw);
+
+/**
+ * @brief Checks whether given monitor reads stuck value.
+ * Checks whether reading of given monitor did not change for MON_STUCK_TIME while other healthy monitor of the
+ * same chip changed its reading later. Sensors which are constant by design (or whole chips) are never stuck.
+ * @param[in] mons Pointer to table of temperature monitors.
+ * @param[in] i    Index of monitor in table.
+ * @param[in] now  Current monotonic time in microseconds.
+ * @return int 0 if reading is not stuck, 1 otherwise.
+ */
+static int mons_read_stuck(const t_mons *const mons, const int i, const long long now);
+
+
+static int mon_load_lbl(struct mon_info *const info) {
     char    *path    = NULL;
     FILE    *file    = NULL;
     ssize_t get_ret  = 0;
     size_t  lbl_size = 0;
 
-    if (!mon)
+    if (!info)
         return 0;
 
-    mon->lbl = NULL;
+    info->lbl = NULL;
 
-    path = concat_fmt(MON_PATH_FMT, mon->id.hw, mon->id.mon, MON_PATH_LBL);
+    path = concat_fmt(MON_PATH_FMT, set_get_str(SET_SYSFS_ROOT), info->id.hw, info->id.mon, MON_PATH_LBL);
     if (!path)
         return 0;
 
+    // Not every chip labels its inputs (acpitz, nvme, ...)
     file = fopen(path, "r");
     free(path);
     if (!file) {
-        log_log(LOG_L_DEBUG, "Unable to open label file of monitor %d", mon->id.mon);
-        return 0;
+        info->lbl = concat_fmt("%s temp%d", info->chip.name, info->id.mon);
+        return (info->lbl) ? 1 : 0;
     }
 
     errno = 0;
-    get_ret = getline(&(mon->lbl), &lbl_size, file);
+    get_ret = getline(&(info->lbl), &lbl_size, file);
     if (get_ret < 2 || errno != 0) {
-        log_log(LOG_L_DEBUG, "Unable to load label of monitor %d", mon->id.mon);
+        log_log(LOG_L_DEBUG, "Unable to load label of monitor %s.%d/%d", info->chip.name, info->chip.id, info->id.mon);
         if (fclose(file) == EOF)
-            log_log(LOG_L_DEBUG, "Unable to close label file of monitor %d", mon->id.mon);
+            log_log(LOG_L_DEBUG, "Unable to close label file of monitor %d", info->id.mon);
         return 0;
     }
 
     // (get_ret - 1) because line ends with "0x0A"
-    mon->lbl[get_ret-1] = '\0';
+    info->lbl[get_ret-1] = '\0';
 
     if (fclose(file) == EOF)
-        log_log(LOG_L_DEBUG, "Unable to close label file of monitpr %d", mon->id.mon);
+        log_log(LOG_L_DEBUG, "Unable to close label file of monitor %d", info->id.mon);
     return 1;
 }
 
 
-static int mon_sel_temp_dest(t_mon *const mon, const char *const suff, int **const dest, char **const path) {
-    if (!mon || !suff || !dest || !path)
+static int mon_load_max(struct mon_info *const info, int *const max) {
+    t_hnd hnd;
+    int   ret = 0;
+
+    if (!info || !max)
         return 0;
 
-    if (strcmp(MON_PATH_MAX, suff) == 0) {
-        *dest = &(mon->temp.max);
-        *path = mon->path.max;
-    } else
+    *max = 0;
+
+    // Chips without max (k10temp, acpitz, ...) may still have crit, otherwise max stays unknown
+    if (!hnd_open(&hnd, info->path.max, O_RDONLY)) {
+        free(info->path.max);
+        info->path.max = concat_fmt(MON_PATH_FMT, set_get_str(SET_SYSFS_ROOT), info->id.hw, info->id.mon,
+                                    MON_PATH_CRIT);
+        if (!info->path.max)
+            return 0;
+        if (!hnd_open(&hnd, info->path.max, O_RDONLY))
+            return 1;
+    }
+
+    ret = hnd_read_int(&hnd, max);
+    if (!ret)
+        log_log(LOG_L_DEBUG, "Invalid max temperature of monitor %s.%d/%d", info->chip.name, info->chip.id, info->id.mon);
+
+    hnd_close(&hnd);
+    return ret;
+}
+
+
+static int mon_load_def(struct mon_info *const info) {
+    if (!info)
+        return 0;
+
+    info->path.rd = concat_fmt(MON_PATH_FMT, set_get_str(SET_SYSFS_ROOT), info->id.hw, info->id.mon, MON_PATH_RD);
+    info->path.max = concat_fmt(MON_PATH_FMT, set_get_str(SET_SYSFS_ROOT), info->id.hw, info->id.mon, MON_PATH_MAX);
+    if (!info->path.rd || !info->path.max)
         return 0;
 
-    if (!(*path))
+    if (!mon_load_lbl(info)) {
+        log_log(LOG_L_DEBUG, "Unable to load label of monitor %s.%d/%d", info->chip.name, info->chip.id, info->id.mon);
         return 0;
+    }
+
     return 1;
 }
 
 
-static int mon_read_temp(t_mon *const mon, const char *const suff) {
-    char    *str     = NULL;
-    size_t  str_size = 0;
-    ssize_t get_ret  = 0;
-    FILE    *file    = NULL;
-    int     *rd_dest = &(mon->temp.real);
-    char    *rd_path = mon->path.rd;
+static void mon_info_free(struct mon_info *const info) {
+    if (!info)
+        return;
+
+    if (info->path.rd)
+        free(info->path.rd);
+    if (info->path.max)
+        free(info->path.max);
+    if (info->lbl)
+        free(info->lbl);
+    if (info->chip.name)
+        free(info->chip.name);
+    free(info->chip.dev);
+}
+
+
+static int mons_load_filter(const struct dirent *dirent) {
+    size_t len = strlen(dirent->d_name);
+
+    return (strncmp(dirent->d_name, "temp", 4) == 0 && len > 10 && strcmp(dirent->d_name+len-6, "_input") == 0);
+}
+
+
+static int mons_load_hw_filter(const struct dirent *dirent) {
+    return (strncmp(dirent->d_name, "hwmon", 5) == 0);
+}
+
+
+static int mons_load_hw_cmp(const struct dirent **a, const struct dirent **b) {
+    int a_id = 0;
+    int b_id = 0;
+
+    str_to_int((*a)->d_name+5, &a_id, 10, NULL);
+    str_to_int((*b)->d_name+5, &b_id, 10, NULL);
 
-    if (!mon || (suff && !mon_sel_temp_dest(mon, suff, &rd_dest, &rd_path)))
+    return (a_id > b_id) - (a_id < b_id);
+}
+
+
+static int mons_scan(const char *const dir, struct dirent ***names, int (*filter)(const struct dirent *),
+                     int (*cmp)(const struct dirent **, const struct dirent **)) {
+    char *path = NULL;
+    int  ret   = 0;
+
+    path = concat_fmt("%s%s", set_get_str(SET_SYSFS_ROOT), dir);
+    if (!path)
+        return -1;
+
+    ret = scandir(path, names, filter, cmp);
+    free(path);
+    return ret;
+}
+
+
+static char *mons_load_dev(const int hw) {
+    const char *root = set_get_str(SET_SYSFS_ROOT);
+    char       *path = NULL;
+    char       *real = NULL;
+    char       *base = NULL;
+    char       *dev  = NULL;
+    char       *end  = NULL;
+    size_t     len   = 0;
+
+    path = concat_fmt(MON_PATH_CLS_FMT, root, hw);
+    if (!path)
+        return NULL;
+
+    // Entries of hwmon class are symlinks into device tree
+    real = realpath(path, NULL);
+    base = realpath(root, NULL);
+    free(path);
+    if (real && base) {
+        len = strlen(base);
+        if (strncmp(real, base, len) == 0 && real[len] == '/') {
+            // Drop ".../hwmon/hwmonN" part, which changes with numbering
+            end = strrchr(real + len, '/');
+            if (end)
+                *end = '\0';
+            end = strrchr(real + len, '/');
+            if (end && strcmp(end, "/hwmon") == 0)
+                *end = '\0';
+            if (real[len] == '/')
+                dev = concat_fmt("%s", real + len);
+        }
+    }
+
+    free(real);
+    free(base);
+    return dev;
+}
+
+
+static int mons_load_name(const int hw, char *const name, const size_t name_size) {
+    char    *path  = NULL;
+    t_hnd   hnd;
+    ssize_t rd_ret = 0;
+
+    path = concat_fmt(MON_PATH_NAME, set_get_str(SET_SYSFS_ROOT), hw);
+    if (!path)
         return 0;
 
-    // Open file for reading
-    file = fopen(rd_path, "r");
-    if (!file) {
-        log_log(LOG_L_DEBUG, "Unable to open temperature file of monitor %d", mon->id.mon);
+    if (!hnd_open(&hnd, path, O_RDONLY)) {
+        free(path);
         return 0;
     }
 
-    // Read line from speed file and remove trailing '\n'
-    errno = 0;
-    get_ret = getline(&str, &str_size, file);
-    if (get_ret < 2 || errno != 0) {
-        log_log(LOG_L_DEBUG, "Invalid temperature file of monitor %d", mon->id.mon);
-        if (str)
-            free(str);
-        if (fclose(file) == EOF)
-            log_log(LOG_L_DEBUG, "Unable to close temperature file of monitor %d", mon->id.mon);
+    rd_ret = hnd_read(&hnd, name, name_size);
+    hnd_close(&hnd);
+    free(path);
+    if (rd_ret < 2)
         return 0;
-    }
-    str[get_ret-1] = '\0';
 
-    // Convert read line to integer
-    if (str_to_int(str, rd_dest, 10, NULL) < 1) {
-        log_log(LOG_L_DEBUG, "Invalid temperature of monitor %d", mon->id.mon);
-        free(str);
-        if (fclose(file) == EOF)
-            log_log(LOG_L_DEBUG, "Unable to close temperature file of monitor %d", mon->id.mon);
+    // Remove trailing '\n'
+    if (name[rd_ret-1] == '\n')
+        name[rd_ret-1] = '\0';
+
+    return 1;
+}
+
+
+static int mons_sel_chip(const char *const name, const int id) {
+    const char *sel   = set_get_str(SET_SENSORS);
+    const char *end   = NULL;
+    size_t     len    = strlen(name);
+    size_t     tok    = 0;
+    int        sel_id = 0;
+
+    if (!sel)
         return 0;
+
+    while (*sel) {
+        // Skip separators
+        while (isspace(*sel) || *sel == ',')
+            sel++;
+
+        end = sel;
+        while (*end && *end != ',' && !isspace(*end))
+            end++;
+        tok = end - sel;
+
+        if (tok == 3 && strncmp(sel, "all", 3) == 0)
+            return 1;
+
+        if (tok >= len && strncmp(sel, name, len) == 0) {
+            if (tok == len)
+                return 1;
+            if (sel[len] == '.' && sysfs_to_int(sel+len+1, tok-len-1, &sel_id) && sel_id == id)
+                return 1;
+        }
+
+        sel = end;
     }
 
-    free(str);
-    if (fclose(file) == EOF)
-        log_log(LOG_L_DEBUG, "Unable to close temperature file of monitor %d", mon->id.mon);
-    return 1;
+    return 0;
 }
 
 
-static int mon_load_def(t_mon *const mon) {
-    if (!mon)
+static int mons_load_chip(t_mons *const mons, int *const cap, const int hw, const char *const name, const int id) {
+    struct dirent   **names    = NULL;
+    int             names_size = 0;
+    int             i          = 0;
+    char            *hw_path   = NULL;
+    char            inv        = 0;
+    struct mon_info *info      = NULL;
+    char            *dev       = NULL;
+
+    hw_path = concat_fmt(MON_PATH_CLS_FMT, set_get_str(SET_SYSFS_ROOT), hw);
+    if (!hw_path)
         return 0;
 
-    mon->path.rd = concat_fmt(MON_PATH_FMT, mon->id.hw, mon->id.mon, MON_PATH_RD);
-    mon->path.max = concat_fmt(MON_PATH_FMT, mon->id.hw, mon->id.mon, MON_PATH_MAX);
-    if (!mon->path.rd || !mon->path.max)
+    // Chip without device keeps being matched by its name and index
+    dev = mons_load_dev(hw);
+
+    errno = 0;
+    names_size = scandir(hw_path, &names, mons_load_filter, alphasort);
+    free(hw_path);
+    if (names_size < 0) {
+        log_log(LOG_L_DEBUG, "Unable to open directory of hwmon%d.", hw);
         return 0;
+    }
+
+    // Walk through chip directory
+    for (i = 0; i < names_size; i++) {
+        // Resize information array
+        if (mons->cnt == *cap) {
+            info = (struct mon_info*)realloc(mons->info, (*cap * 2 + 8) * sizeof(*info));
+            if (!info)
+                break;
+            mons->info = info;
+            *cap = *cap * 2 + 8;
+        }
+
+        info = &(mons->info[mons->cnt]);
+        memset(info, 0, sizeof(*info));
+        info->id.hw = hw;
+        info->chip.id = id;
+
+        // Get id of monitor
+        if (str_to_int(names[i]->d_name+4, &(info->id.mon), 10, &inv) < 0 || inv != '_') {
+            log_log(LOG_L_DEBUG, "Invalid monitor filename encountered.");
+            break;
+        }
+
+        // Load monitor defaults, array now owns it
+        info->chip.name = concat_fmt("%s", name);
+        info->chip.dev = (dev) ? concat_fmt("%s", dev) : NULL;
+        if (!info->chip.name || (dev && !info->chip.dev) || !mon_load_def(info)) {
+            log_log(LOG_L_DEBUG, "Unable to load defaults of monitor %s.%d/%d", name, id, info->id.mon);
+            mon_info_free(info);
+            break;
+        }
+
+        mons->cnt++;
+    }
+
+    free(dev);
+    free_dirent_names(names, names_size);
+    return (i == names_size) ? 1 : 0;
+}
+
 
-    if (!mon_read_temp(mon, MON_PATH_MAX)) {
-        log_log(LOG_L_DEBUG, "Unable to load max temperature of monitor %d", mon->id.mon);
+static int mons_load_tbl(t_mons *const mons) {
+    int i = 0;
+
+    // Hot arrays share one block, so reading and reduction stay in few cache lines
+    mons->temp = (int*)malloc(MON_ARR_CNT * mons->cnt * sizeof(*(mons->temp)));
+    mons->hnd = (t_hnd*)malloc(mons->cnt * sizeof(*(mons->hnd)));
+    mons->chg = (long long*)malloc(mons->cnt * sizeof(*(mons->chg)));
+    if (!mons->temp || !mons->hnd || !mons->chg)
         return 0;
+    mons->max = mons->temp + mons->cnt;
+    mons->flags = mons->max + mons->cnt;
+    mons->fails = mons->flags + mons->cnt;
+    mons->skip = mons->fails + mons->cnt;
+    mons->last = mons->skip + mons->cnt;
+
+    for (i = 0; i < mons->cnt; i++) {
+        mons->temp[i] = MON_TEMP_INV;
+        mons->flags[i] = 0;
+        mons->fails[i] = 0;
+        mons->skip[i] = 0;
+        mons->last[i] = MON_TEMP_INV;
+        mons->chg[i] = 0;
+        mons->hnd[i].fd = -1;
     }
 
-    mon->temp.real = 0;
+    for (i = 0; i < mons->cnt; i++) {
+        if (!mon_load_max(&(mons->info[i]), &(mons->max[i]))) {
+            log_log(LOG_L_DEBUG, "Unable to load max temperature of monitor %s.%d/%d",
+                    mons->info[i].chip.name, mons->info[i].chip.id, mons->info[i].id.mon);
+            return 0;
+        }
+
+        if (!hnd_open(&(mons->hnd[i]), mons->info[i].path.rd, O_RDONLY)) {
+            log_log(LOG_L_DEBUG, "Unable to open temperature file of monitor %s.%d/%d",
+                    mons->info[i].chip.name, mons->info[i].chip.id, mons->info[i].id.mon);
+            return 0;
+        }
+    }
 
-    if (!mon_load_lbl(mon)) {
-        log_log(LOG_L_DEBUG, "Unable to load label of monitor %d", mon->id.mon);
+    return 1;
+}
+
+
+static int mons_load_alrm(t_mons *const mons) {
+    static const char *const sufs[] = {MON_PATH_ALRM_MAX, MON_PATH_ALRM_CRIT};
+    struct mon_alrm          *alrm  = &(mons->alrm);
+    char                     *path  = NULL;
+    int                      fd     = 0;
+    int                      i      = 0;
+    int                      j      = 0;
+
+    alrm->fds = (struct pollfd*)malloc(2 * mons->cnt * sizeof(*(alrm->fds)));
+    alrm->mon = (int*)malloc(3 * 2 * mons->cnt * sizeof(*(alrm->mon)));
+    if (!alrm->fds || !alrm->mon)
         return 0;
+    alrm->on = alrm->mon + 2 * mons->cnt;
+    alrm->sfx = alrm->on + 2 * mons->cnt;
+
+    for (i = 0; i < mons->cnt; i++) {
+        for (j = 0; j < 2; j++) {
+            path = concat_fmt(MON_PATH_FMT, set_get_str(SET_SYSFS_ROOT), mons->info[i].id.hw, mons->info[i].id.mon,
+                              sufs[j]);
+            if (!path)
+                return 0;
+
+            // Most chips provide no alarms at all
+            fd = open(path, O_RDONLY | O_CLOEXEC);
+            free(path);
+            if (fd < 0)
+                continue;
+
+            alrm->fds[alrm->cnt].fd = fd;
+            alrm->fds[alrm->cnt].events = POLLPRI;
+            alrm->fds[alrm->cnt].revents = 0;
+            alrm->mon[alrm->cnt] = i;
+            alrm->on[alrm->cnt] = 0;
+            alrm->sfx[alrm->cnt] = j;
+            alrm->cnt++;
+        }
     }
 
+    // Reading arms alarms for poll()
+    mons_read_alarm(mons, 1);
+
+    if (alrm->cnt > 0)
+        log_log(LOG_L_INFO, "Watching %d temperature alarms", alrm->cnt);
+
     return 1;
 }
 
 
-static int mons_find_hw_id(void) {
-    int           id         = -1;
-    struct dirent *dirent    = NULL;
-    DIR           *dir       = NULL;
-    char          *lpath     = NULL;
-    ssize_t       llen       = 0;
-    const size_t  ldest_size = 256;
-    char          ldest[ldest_size];
+static int mons_load_cpu_filter(const struct dirent *dirent) {
+    return (strncmp(dirent->d_name, "cpu", 3) == 0 && isdigit((unsigned char)dirent->d_name[3]));
+}
+
+
+static int mons_load_topo(const int cpu, const char *const attr) {
+    char    buf[HND_BUF_SIZE];
+    char    *path  = NULL;
+    t_hnd   hnd;
+    ssize_t rd_ret = 0;
+    int     val    = -1;
 
-    dir = opendir(MON_PATH_CLS);
-    if (!dir)
+    path = concat_fmt(MON_PATH_TOPO_FMT, set_get_str(SET_SYSFS_ROOT), cpu, attr);
+    if (!path)
         return -1;
 
-    while ((dirent = readdir(dir))) {
+    // Lists like "0,4" or "0-1" end with first integer
+    if (hnd_open(&hnd, path, O_RDONLY)) {
+        rd_ret = hnd_read(&hnd, buf, sizeof(buf));
+        if (rd_ret < 1 || str_to_int(buf, &val, 10, NULL) < 0)
+            val = -1;
+        hnd_close(&hnd);
+    }
 
-        if (dirent->d_type != DT_LNK || strncmp(dirent->d_name, "hwmon", 5) != 0)
-            continue;
+    free(path);
+    return val;
+}
 
-        lpath = concat_fmt("%s/%s", MON_PATH_CLS, dirent->d_name);
-        if (!lpath) {
-            if (closedir(dir) < 0)
-                log_log(LOG_L_DEBUG, "Unable to close %s directory", MON_PATH_CLS);
-            return -1;
-        }
 
-        errno = 0;
-        llen = readlink(lpath, ldest, ldest_size-1);
-        if (llen < 1 || errno != 0) {
-            free(lpath);
-            if (closedir(dir) < 0)
-                log_log(LOG_L_DEBUG, "Unable to close %s directory", MON_PATH_CLS);
-            return -1;
-        }
-        ldest[llen] = '\0';
+static int mons_load_thr_cnt(t_mons *const mons, const int cpu, const int kind) {
+    struct mon_thr *thr = &(mons->thr);
+    char           *path = NULL;
 
-        if (!strstr(ldest, "coretemp.0")) {
-            free(lpath);
-            continue;
-        }
+    path = concat_fmt(MON_PATH_THR_FMT, set_get_str(SET_SYSFS_ROOT), cpu, (kind == MON_THR_PKG) ? "package" : "core");
+    if (!path)
+        return 0;
 
-        if (str_to_int(dirent->d_name+5, &id, 10, NULL) < 1) {
-            free(lpath);
-            if (closedir(dir) < 0)
-                log_log(LOG_L_DEBUG, "Unable to close %s directory", MON_PATH_CLS);
-            return -1;
-        }
-        
-        break;
+    if (!hnd_open(&(thr->hnd[thr->cnt]), path, O_RDONLY) ||
+        !hnd_read_int(&(thr->hnd[thr->cnt]), &(thr->last[thr->cnt]))) {
+        hnd_close(&(thr->hnd[thr->cnt]));
+        free(path);
+        return 0;
     }
 
-    free(lpath);
-    if (closedir(dir) < 0)
-        log_log(LOG_L_DEBUG, "Unable to close %s directory", MON_PATH_CLS);
-    return id;
+    thr->path[thr->cnt] = path;
+    thr->kind[thr->cnt] = kind;
+    thr->cnt++;
+    return 1;
 }
 
 
-static int mons_load_filter(const struct dirent *dirent) {
-    return (strncmp(dirent->d_name, "temp", 4) == 0);
+static int mons_load_thr(t_mons *const mons) {
+    struct mon_thr *thr        = &(mons->thr);
+    struct dirent  **names     = NULL;
+    int            *pkgs       = NULL;
+    int            names_size  = 0;
+    int            pkgs_size   = 0;
+    int            cpu         = 0;
+    int            pkg         = 0;
+    int            i           = 0;
+    int            j           = 0;
+
+    thr->start = time_mono_us();
+
+    names_size = mons_scan(MON_PATH_CPU, &names, mons_load_cpu_filter, NULL);
+    if (names_size < 1) {
+        if (names_size == 0)
+            free(names);
+        return 1;
+    }
+
+    thr->hnd = (t_hnd*)malloc(2 * names_size * sizeof(*(thr->hnd)));
+    thr->path = (char**)malloc(2 * names_size * sizeof(*(thr->path)));
+    thr->last = (int*)malloc(2 * names_size * sizeof(*(thr->last)));
+    thr->kind = (int*)malloc(2 * names_size * sizeof(*(thr->kind)));
+    pkgs = (int*)malloc(names_size * sizeof(*pkgs));
+    if (!thr->hnd || !thr->path || !thr->last || !thr->kind || !pkgs) {
+        free(pkgs);
+        free_dirent_names(names, names_size);
+        return 0;
+    }
+
+    for (i = 0; i < names_size; i++) {
+        if (str_to_int(names[i]->d_name+3, &cpu, 10, NULL) < 1)
+            continue;
+
+        // Core counter is shared by hardware threads of core
+        if (mons_load_topo(cpu, "thread_siblings_list") == cpu)
+            mons_load_thr_cnt(mons, cpu, MON_THR_CORE);
+
+        // Package counter is shared by all CPUs of package
+        pkg = mons_load_topo(cpu, "physical_package_id");
+        for (j = 0; j < pkgs_size && pkgs[j] != pkg; j++)
+            ;
+        if (j == pkgs_size && mons_load_thr_cnt(mons, cpu, MON_THR_PKG))
+            pkgs[pkgs_size++] = pkg;
+    }
+
+    free(pkgs);
+    free_dirent_names(names, names_size);
+
+    if (thr->cnt > 0)
+        log_log(LOG_L_INFO, "Watching %d CPU throttle counters", thr->cnt);
+    else
+        log_log(LOG_L_DEBUG, "%s", "No CPU throttle counters found");
+
+    return 1;
 }
 
 
-t_node* mons_load(void) {
+static int mons_load_id(const int hw, const char *const name) {
     struct dirent **names    = NULL;
+    char          buf[HND_BUF_SIZE];
     int           names_size = 0;
-    char          *hw_path   = NULL;
-    char          inv        = 0;
-    int           id_prev    = 0;
-    int           to_int_ret = 0;
-    t_mon         mon;
-    t_node        *mons      = NULL;
-
-    mon.id.hw = mons_find_hw_id();
-    if (mon.id.hw < 0) {
-        log_log(LOG_L_DEBUG, "Unable to locate coretemp hwmon entry.");
-        return NULL;
+    int           other      = 0;
+    int           id         = 0;
+    int           i          = 0;
+
+    names_size = mons_scan(MON_PATH_CLS, &names, mons_load_hw_filter, mons_load_hw_cmp);
+    if (names_size < 0)
+        return -1;
+
+    for (i = 0; i < names_size; i++) {
+        if (str_to_int(names[i]->d_name+5, &other, 10, NULL) < 1 || other >= hw)
+            continue;
+        if (mons_load_name(other, buf, sizeof(buf)) && strcmp(buf, name) == 0)
+            id++;
     }
 
-    hw_path = concat_fmt("%s/hwmon%d", MON_PATH_BASE, mon.id.hw);
-    if (!hw_path)
+    free_dirent_names(names, names_size);
+    return id;
+}
+
+
+static int mons_open_alrm(t_mons *const mons, const int i) {
+    static const char *const sufs[] = {MON_PATH_ALRM_MAX, MON_PATH_ALRM_CRIT};
+    struct mon_alrm          *alrm  = &(mons->alrm);
+    const struct mon_info    *info  = &(mons->info[alrm->mon[i]]);
+    char                     *path  = NULL;
+
+    path = concat_fmt(MON_PATH_FMT, set_get_str(SET_SYSFS_ROOT), info->id.hw, info->id.mon, sufs[alrm->sfx[i]]);
+    if (!path)
+        return 0;
+
+    alrm->fds[i].fd = open(path, O_RDONLY | O_CLOEXEC);
+    alrm->fds[i].revents = POLLPRI;
+    free(path);
+
+    return (alrm->fds[i].fd >= 0);
+}
+
+
+static int mons_attach(t_mons *const mons, const int i, const int hw) {
+    struct mon_info *info = &(mons->info[i]);
+    int             j     = 0;
+
+    info->id.hw = hw;
+    free(info->path.rd);
+    free(info->path.max);
+    info->path.rd = concat_fmt(MON_PATH_FMT, set_get_str(SET_SYSFS_ROOT), info->id.hw, info->id.mon, MON_PATH_RD);
+    info->path.max = concat_fmt(MON_PATH_FMT, set_get_str(SET_SYSFS_ROOT), info->id.hw, info->id.mon, MON_PATH_MAX);
+    if (!info->path.rd || !info->path.max || !mon_load_max(info, &(mons->max[i])))
+        return 0;
+
+    // Handle holds path, which was just replaced
+    if (!hnd_open(&(mons->hnd[i]), info->path.rd, O_RDONLY))
+        return 0;
+
+    for (j = 0; j < mons->alrm.cnt; j++)
+        if (mons->alrm.mon[j] == i && !mons_open_alrm(mons, j))
+            log_log(LOG_L_DEBUG, "Unable to reopen alarm of monitor %s.%d/%d", info->chip.name, info->chip.id,
+                    info->id.mon);
+
+    mons->temp[i] = MON_TEMP_INV;
+    mons->flags[i] = 0;
+    mons->fails[i] = 0;
+    mons->skip[i] = 0;
+    mons->last[i] = MON_TEMP_INV;
+    mons->chg[i] = 0;
+
+    return 1;
+}
+
+
+static int mons_read_stuck(const t_mons *const mons, const int i, const long long now) {
+    const struct mon_chip *chip = &(mons->info[i].chip);
+    int                   j     = 0;
+
+    if (now < 0 || now - mons->chg[i] < MON_STUCK_TIME)
+        return 0;
+
+    // Constant reading is stuck only when other monitor of the same chip kept changing meanwhile
+    for (j = 0; j < mons->cnt; j++) {
+        if (j == i || !(mons->flags[j] & MON_F_OK) || (mons->flags[j] & MON_F_QUAR))
+            continue;
+        if (mons->info[j].chip.id != chip->id || strcmp(mons->info[j].chip.name, chip->name) != 0)
+            continue;
+        if (mons->chg[j] - mons->chg[i] >= MON_STUCK_TIME)
+            return 1;
+    }
+
+    return 0;
+}
+
+
+t_mons* mons_load(void) {
+    struct dirent **names                = NULL;
+    int           names_size             = 0;
+    int           i                      = 0;
+    int           j                      = 0;
+    int           hw                     = 0;
+    int           id                     = 0;
+    int           cap                    = 0;
+    char          (*chips)[HND_BUF_SIZE] = NULL;
+    t_mons        *mons                  = NULL;
+
+    mons = (t_mons*)calloc(1, sizeof(*mons));
+    if (!mons)
         return NULL;
 
+    // One pass over hwmon class, ordered by hwmon id
     errno = 0;
-    names_size = scandir(hw_path, &names, mons_load_filter, alphasort);
-    free(hw_path);
+    names_size = mons_scan(MON_PATH_CLS, &names, mons_load_hw_filter, mons_load_hw_cmp);
     if (names_size < 0) {
-        log_log(LOG_L_DEBUG, "Unable to open system monitors directory.");
+        log_log(LOG_L_DEBUG, "Unable to open %s%s directory.", set_get_str(SET_SYSFS_ROOT), MON_PATH_CLS);
+        mons_free(mons);
         return NULL;
     }
 
-    // Walk through fans directory
-    while (names_size--) {
-        // Get id of monitor
-        to_int_ret = str_to_int(names[names_size]->d_name+4, &(mon.id.mon), 10, &inv);
-        if (to_int_ret < 0 || inv != '_') {
-            list_free(mons, (void (*)(void *, int))mon_free);
-            mon_free(&mon, 0);
-            free_dirent_names(names, names_size);
-            log_log(LOG_L_DEBUG, "Invalid monitor filename encountered.");
-            return NULL;
-        }
+    chips = malloc((names_size + 1) * sizeof(*chips));
+    if (!chips) {
+        free_dirent_names(names, names_size);
+        mons_free(mons);
+        return NULL;
+    }
 
-        // Skip already finished monitor
-        if (mon.id.mon == id_prev) {
-            free(names[names_size]);
+    for (i = 0; i < names_size; i++) {
+        chips[i][0] = '\0';
+
+        if (str_to_int(names[i]->d_name+5, &hw, 10, NULL) < 1 || !mons_load_name(hw, chips[i], sizeof(*chips))) {
+            log_log(LOG_L_DEBUG, "Unable to load chip name of %s", names[i]->d_name);
             continue;
         }
-        id_prev = mon.id.mon;
 
-        // Load monitor defaults and append it to linked list of monitors
-        if (!mon_load_def(&mon) || !list_push_front(&mons, &mon, sizeof(mon))) {
-            list_free(mons, (void (*)(void *, int))mon_free);
-            mon_free(&mon, 0);
+        // Index of chip amongst chips with the same name
+        for (id = 0, j = 0; j < i; j++)
+            if (strcmp(chips[j], chips[i]) == 0)
+                id++;
+
+        if (!mons_sel_chip(chips[i], id))
+            continue;
+
+        if (!mons_load_chip(mons, &cap, hw, chips[i], id)) {
+            log_log(LOG_L_DEBUG, "Unable to load monitors of sensor source %s.%d", chips[i], id);
+            free(chips);
             free_dirent_names(names, names_size);
-            log_log(LOG_L_DEBUG, "Unable to load defaults of monitor %d", mon.id.mon);
+            mons_free(mons);
             return NULL;
         }
 
-        free(names[names_size]);
+        log_log(LOG_L_INFO, "Using sensor source %s.%d (hwmon%d)", chips[i], id, hw);
+    }
+
+    free(chips);
+    free_dirent_names(names, names_size);
+
+    if (mons->cnt == 0) {
+        log_log(LOG_L_DEBUG, "No monitors found in selected sensor sources %s", set_get_str(SET_SENSORS));
+        mons_free(mons);
+        return NULL;
+    }
+
+    if (!mons_load_tbl(mons) || !mons_load_alrm(mons) || !mons_load_thr(mons)) {
+        mons_free(mons);
+        return NULL;
     }
 
-    if (names)
-        free(names);
     return mons;
 }
 
 
-int mons_read_temp(t_node *mons) {
-    int   temp  = -1;
-    t_mon *mon  = NULL;
+void mons_read_temp(t_mons *const mons) {
+    int i = 0;
+
+    for (i = 0; i < mons->cnt; i++)
+        if (!mons_read_skip(mons, i))
+            mons_read_done(mons, i, hnd_read_int(&(mons->hnd[i]), &(mons->temp[i])));
+}
+
+
+int mons_read_skip(t_mons *const mons, const int i) {
+    if (mons->flags[i] & MON_F_GONE)
+        return 1;
+
+    if (mons->skip[i] < 1)
+        return 0;
+
+    mons->skip[i]--;
+    return 1;
+}
+
+
+void mons_read_done(t_mons *const mons, const int i, const int ok) {
+    const struct mon_info *info = &(mons->info[i]);
+    int                   temp  = mons->temp[i];
+    int                   stuck = 0;
+    int                   bad   = 0;
+    long long             now   = 0;
+
+    if (!ok) {
+        // Handle is reopened by next read
+        hnd_close(&(mons->hnd[i]));
+        mons->temp[i] = MON_TEMP_INV;
+        mons->flags[i] &= ~MON_F_OK;
+
+        // Retry after 1, 2, 4, ... polls
+        mons->fails[i]++;
+        mons->skip[i] = 1 << min(mons->fails[i] - 1, MON_BACKOFF_MAX);
+
+        if (!(mons->flags[i] & MON_F_FAIL)) {
+            mons->flags[i] |= MON_F_FAIL;
+            log_log(LOG_L_WARN, "Monitor %s.%d/%d failed to read, excluding it until it recovers",
+                    info->chip.name, info->chip.id, info->id.mon);
+        }
+        return;
+    }
 
-    while (mons) {
-        mon = mons->data;
+    mons->flags[i] |= MON_F_OK;
 
-        if (!mon_read_temp(mon, NULL)) {
-            log_log(LOG_L_DEBUG, "Unable to read temperature from monitor %d", mon->id.mon);
-            mons = mons->next;
+    if (mons->flags[i] & MON_F_FAIL) {
+        mons->flags[i] &= ~MON_F_FAIL;
+        log_log(LOG_L_INFO, "Monitor %s.%d/%d recovered after %d failed reads",
+                info->chip.name, info->chip.id, info->id.mon, mons->fails[i]);
+    }
+    mons->fails[i] = 0;
+
+    // Stuck or out of range reading
+    now = time_mono_us();
+    if (temp != mons->last[i] || mons->chg[i] <= 0)
+        mons->chg[i] = now;
+    mons->last[i] = temp;
+    stuck = mons_read_stuck(mons, i, now);
+    bad = (stuck || temp <= MON_VALID_MIN || temp >= MON_VALID_MAX);
+
+    if (bad && !(mons->flags[i] & MON_F_QUAR)) {
+        mons->flags[i] |= MON_F_QUAR;
+        log_log(LOG_L_WARN, "Monitor %s.%d/%d reads %s value %d, putting it into quarantine",
+                info->chip.name, info->chip.id, info->id.mon, stuck ? "stuck" : "out of range", temp);
+    } else if (!bad && (mons->flags[i] & MON_F_QUAR)) {
+        mons->flags[i] &= ~MON_F_QUAR;
+        log_log(LOG_L_INFO, "Monitor %s.%d/%d left quarantine", info->chip.name, info->chip.id, info->id.mon);
+    }
+
+    if (mons->flags[i] & MON_F_QUAR)
+        mons->temp[i] = MON_TEMP_INV;
+}
+
+
+int mons_read_alarm(t_mons *const mons, const int all) {
+    struct mon_alrm       *alrm   = &(mons->alrm);
+    const struct mon_info *info   = NULL;
+    char                  buf[HND_BUF_SIZE];
+    ssize_t               rd_ret  = 0;
+    int                   on      = 0;
+    int                   i       = 0;
+
+    for (i = 0; i < alrm->cnt; i++) {
+        if (alrm->fds[i].fd < 0 || (!all && !alrm->fds[i].revents))
             continue;
+        alrm->fds[i].revents = 0;
+        info = &(mons->info[alrm->mon[i]]);
+
+        // sysfs rearms poll() only after read from offset 0
+        do {
+            rd_ret = pread(alrm->fds[i].fd, buf, sizeof(buf), 0);
+        } while (rd_ret < 0 && errno == EINTR);
+
+        if (!hnd_parse_int(buf, rd_ret, &on)) {
+            log_log(LOG_L_WARN, "Unable to read alarm of monitor %s.%d/%d, not watching it anymore",
+                    info->chip.name, info->chip.id, info->id.mon);
+            close(alrm->fds[i].fd);
+            alrm->fds[i].fd = -1;
+            on = 0;
         }
 
-        if (temp < mon->temp.real)
-            temp = mon->temp.real;
-        
-        mons = mons->next;
+        on = (on != 0);
+        if (on == alrm->on[i])
+            continue;
+
+        alrm->on[i] = on;
+        alrm->act += (on) ? 1 : -1;
+        if (on)
+            log_log(LOG_L_WARN, "Monitor %s.%d/%d raised alarm", info->chip.name, info->chip.id, info->id.mon);
+        else
+            log_log(LOG_L_INFO, "Monitor %s.%d/%d cleared alarm", info->chip.name, info->chip.id, info->id.mon);
     }
 
+    return alrm->act;
+}
+
+
+int mons_read_thr(t_mons *const mons, const long long now) {
+    struct mon_thr *thr              = &(mons->thr);
+    int            evts[MON_THR_CNT] = {0};
+    int            val               = 0;
+    int            i                 = 0;
+
+    for (i = 0; i < thr->cnt; i++) {
+        if (!hnd_read_int(&(thr->hnd[i]), &val))
+            continue;
+        // Counter which went back (wrapped or CPU was offlined) starts again
+        if (val > thr->last[i])
+            evts[thr->kind[i]] += val - thr->last[i];
+        thr->last[i] = val;
+    }
+
+    for (i = 0; i < MON_THR_CNT; i++)
+        thr->evts[i] += evts[i];
+
+    if (evts[MON_THR_CORE] > 0 || evts[MON_THR_PKG] > 0)
+        thr->hit = now;
+
+    return max(evts[MON_THR_CORE], evts[MON_THR_PKG]);
+}
+
+
+int mons_get_temp(const t_mons *const mons) {
+    const int *temps = mons->temp;
+    int       temp   = MON_TEMP_INV;
+    int       i      = 0;
+
+    // Monitors which failed to read hold MON_TEMP_INV
+    for (i = 0; i < mons->cnt; i++)
+        temp = (temps[i] > temp) ? temps[i] : temp;
+
     // If failed to load at least one temperature, crank up the fans
     if (temp < 0) {
         log_log(LOG_L_ERROR, "Unable to read temperature from monitors.");
-        return set_get_int(SET_TEMP_HIGH);
+        return set_get_int(SET_TEMP_HIGH) * 1000;
     }
 
-    return (temp / 1000);
+    return temp;
 }
 
 
-int mons_read_temp_max(const t_node *mons) {
-    t_mon *mon = mons->data;
-    int   temp = mon->temp.max;
+int mons_read_temp_max(const t_mons *const mons) {
+    int temp = -1;
+    int i    = 0;
+
+    for (i = 0; i < mons->cnt; i++) {
+        // Skip monitors with unknown max temperature
+        if (mons->max[i] > 0 && (temp < 0 || temp > mons->max[i]))
+            temp = mons->max[i];
+    }
+
+    return (temp < 0) ? -1 : (temp / 1000);
+}
 
-    while (mons) {
-        mon = mons->data;
 
-        if (temp > mon->temp.max)
-            temp = mon->temp.max;
+void mons_free(t_mons *mons) {
+    int i = 0;
 
-        mons = mons->next;
+    if (!mons)
+        return;
+
+    if (mons->hnd)
+        for (i = 0; i < mons->cnt; i++)
+            hnd_close(&(mons->hnd[i]));
+
+    if (mons->info)
+        for (i = 0; i < mons->cnt; i++)
+            mon_info_free(&(mons->info[i]));
+
+    if (mons->alrm.fds)
+        for (i = 0; i < mons->alrm.cnt; i++)
+            if (mons->alrm.fds[i].fd >= 0)
+                close(mons->alrm.fds[i].fd);
+
+    for (i = 0; i < mons->thr.cnt; i++) {
+        hnd_close(&(mons->thr.hnd[i]));
+        free(mons->thr.path[i]);
     }
 
-    return (temp / 1000);
+    if (mons->temp)
+        free(mons->temp);
+    if (mons->hnd)
+        free(mons->hnd);
+    free(mons->chg);
+    if (mons->info)
+        free(mons->info);
+    if (mons->alrm.fds)
+        free(mons->alrm.fds);
+    if (mons->alrm.mon)
+        free(mons->alrm.mon);
+    free(mons->thr.hnd);
+    free(mons->thr.path);
+    free(mons->thr.last);
+    free(mons->thr.kind);
+
+    free(mons);
 }
 
 
-void mon_free(t_mon *mon, int self) {
-    if (!mon)
+void mons_print(const t_mons *const mons, FILE *const file) {
+    const struct mon_info *info = NULL;
+    int                   i     = 0;
+
+    if (!mons || !file)
         return;
 
-    if (mon->path.rd)
-        free(mon->path.rd);
-    if (mon->path.max)
-        free(mon->path.max);
-    if (mon->lbl)
-        free(mon->lbl);
-    
-    if (self)
-        free(mon);
+    for (i = 0; i < mons->cnt; i++) {
+        info = &(mons->info[i]);
+        fprintf(file, "Monitor %d - %s\n", info->id.mon, info->lbl);
+        fprintf(file, "Chip: %s.%d (hwmon%d)\n", info->chip.name, info->chip.id, info->id.hw);
+        fprintf(file, "Max temp: %d°C\n", mons->max[i] / 1000);
+        fprintf(file, "Read: %s\n", info->path.rd);
+        fprintf(file, "Max: %s\n\n", info->path.max);
+    }
+}
+
+
+void mons_print_excl(const t_mons *const mons, FILE *const file) {
+    const struct mon_info *info = NULL;
+    long long             now   = time_mono_us();
+    int                   i     = 0;
+    int                   cnt   = 0;
+
+    if (!mons || !file)
+        return;
+
+    for (i = 0; i < mons->cnt; i++) {
+        info = &(mons->info[i]);
+
+        if (mons->flags[i] & MON_F_FAIL)
+            fprintf(file, "Monitor %s.%d/%d - %s: failing (%d failed reads, retry in %d polls)\n",
+                    info->chip.name, info->chip.id, info->id.mon, info->lbl, mons->fails[i], mons->skip[i]);
+        else if (mons->flags[i] & MON_F_GONE)
+            fprintf(file, "Monitor %s.%d/%d - %s: gone (chip was removed)\n",
+                    info->chip.name, info->chip.id, info->id.mon, info->lbl);
+        else if (mons->flags[i] & MON_F_QUAR)
+            fprintf(file, "Monitor %s.%d/%d - %s: quarantined (last value %d, unchanged for %lld s)\n",
+                    info->chip.name, info->chip.id, info->id.mon, info->lbl, mons->last[i],
+                    (mons->chg[i] > 0 && now > mons->chg[i]) ? (now - mons->chg[i]) / 1000000 : 0);
+        else
+            continue;
+
+        cnt++;
+    }
+
+    fprintf(file, "Excluded monitors: %d of %d\n", cnt, mons->cnt);
+}
+
+
+int mons_hw_del(t_mons *const mons, const int hw) {
+    struct mon_alrm *alrm = &(mons->alrm);
+    int             cnt   = 0;
+    int             i     = 0;
+
+    for (i = 0; i < mons->cnt; i++) {
+        if (mons->info[i].id.hw != hw || (mons->flags[i] & MON_F_GONE))
+            continue;
+
+        hnd_close(&(mons->hnd[i]));
+        mons->temp[i] = MON_TEMP_INV;
+        mons->flags[i] = MON_F_GONE;
+        cnt++;
+    }
+
+    // Closing alarm also removes it from every poll and epoll
+    for (i = 0; i < alrm->cnt; i++) {
+        if (!(mons->flags[alrm->mon[i]] & MON_F_GONE) || alrm->fds[i].fd < 0)
+            continue;
+        close(alrm->fds[i].fd);
+        alrm->fds[i].fd = -1;
+        alrm->fds[i].revents = 0;
+        if (alrm->on[i])
+            alrm->act--;
+        alrm->on[i] = 0;
+    }
+
+    if (cnt > 0)
+        log_log(LOG_L_WARN, "Chip hwmon%d was removed, excluding its %d monitors until it appears again", hw, cnt);
+
+    return cnt;
+}
+
+
+int mons_hw_add(t_mons *const mons, const int hw) {
+    const struct mon_chip *chip = NULL;
+    char                  name[HND_BUF_SIZE];
+    char                  *dev  = NULL;
+    int                   id    = 0;
+    int                   cnt   = 0;
+    int                   i     = 0;
+
+    // Chip may have been replaced without being removed first
+    mons_hw_del(mons, hw);
+
+    if (!mons_load_name(hw, name, sizeof(name)))
+        return -1;
+
+    // Index amongst chips with the same name follows current numbering, which may differ from start
+    id = mons_load_id(hw, name);
+    if (id < 0)
+        return -1;
+    dev = mons_load_dev(hw);
+
+    for (i = 0; i < mons->cnt; i++) {
+        chip = &(mons->info[i].chip);
+        if (!(mons->flags[i] & MON_F_GONE) || strcmp(chip->name, name) != 0)
+            continue;
+        if ((chip->dev && dev) ? strcmp(chip->dev, dev) != 0 : chip->id != id)
+            continue;
+        id = chip->id;
+
+        if (!mons_attach(mons, i, hw)) {
+            log_log(LOG_L_DEBUG, "Unable to attach monitor %s.%d/%d to hwmon%d", name, id, mons->info[i].id.mon, hw);
+            mons->flags[i] = MON_F_GONE;
+            hnd_close(&(mons->hnd[i]));
+            continue;
+        }
+        cnt++;
+    }
+
+    free(dev);
+
+    // Reading arms reopened alarms for poll()
+    mons_read_alarm(mons, 0);
+
+    if (cnt > 0)
+        log_log(LOG_L_INFO, "Chip %s.%d appeared as hwmon%d, attached its %d monitors", name, id, hw, cnt);
+    else if (mons_sel_chip(name, id))
+        log_log(LOG_L_INFO, "New sensor source %s.%d (hwmon%d) is used only after restart", name, id, hw);
+
+    return cnt;
 }
 
 
-void mon_print(const t_mon *const mon, FILE *const file) {
-    if (!mon)
+void mons_print_thr(const t_mons *const mons, const long long now, FILE *const file) {
+    const struct mon_thr *thr = NULL;
+    long long            run  = 0;
+
+    if (!mons || !file)
         return;
 
-    fprintf(file, "Monitor %d - %s\n", mon->id.mon, mon->lbl);
-    fprintf(file, "Max temp: %d°C\n", mon->temp.max / 1000);
-    fprintf(file, "Read: %s\n", mon->path.rd);
-    fprintf(file, "Max: %s\n", mon->path.max);
-}
\ No newline at end of file
+    thr = &(mons->thr);
+    run = now - thr->start;
+
+    fprintf(file, "Throttle counters: %d\n", thr->cnt);
+    fprintf(file, "Throttle events: %lld core, %lld package\n", thr->evts[MON_THR_CORE], thr->evts[MON_THR_PKG]);
+    fprintf(file, "Throttle events per hour: %.2f core, %.2f package\n",
+            (run > 0) ? thr->evts[MON_THR_CORE] * 3600000000.0 / run : 0.0,
+            (run > 0) ? thr->evts[MON_THR_PKG] * 3600000000.0 / run : 0.0);
+    if (thr->hit > 0)
+        fprintf(file, "Last throttle: %lld s ago\n", (now - thr->hit) / 1000000);
+    else
+        fprintf(file, "Last throttle: never\n");
+}
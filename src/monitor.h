@@ -11,8 +11,40 @@
 #define MACFAND_MONITOR_H_fajkdsfbua
 
 #include <stdio.h>
+#include <limits.h>
+#include <poll.h>
 
-#include "linked.h"
+#include "handle.h"
+
+/**
+ * @brief Temperature of monitor which is not valid.
+ * Temperature saved for monitor which failed to read, so it never wins max reduction.
+ */
+#define MON_TEMP_INV INT_MIN
+
+/**
+ * @brief Enum holding monitor flags.
+ * Enum holding flags of monitor. MON_F_OK is set when last reading of monitor succeeded, MON_F_FAIL
+ * while monitor keeps failing to read and is retried with exponential backoff, MON_F_QUAR while
+ * it reads stuck or out of range values and MON_F_GONE while its chip is removed from system.
+ * Failing, quarantined and gone monitors are excluded from control.
+ */
+enum mon_flag {
+    MON_F_OK   = 1,
+    MON_F_FAIL = 2,
+    MON_F_QUAR = 4,
+    MON_F_GONE = 8
+};
+
+/**
+ * @brief Enum holding kinds of CPU throttle counters.
+ * Enum holding kinds of thermal throttle counters, which are core_throttle_count and package_throttle_count.
+ */
+enum mon_thr_kind {
+    MON_THR_CORE,
+    MON_THR_PKG,
+    MON_THR_CNT
+};
 
 /**
  * @brief Struct holding all monitor ids.
@@ -24,12 +56,15 @@ struct mon_id {
 };
 
 /**
- * @brief Struct holding all monitor temperatures.
- * Struct holding all monitor temperatures, which are real (current) and max.
+ * @brief Struct holding chip of monitor.
+ * Struct holding name of chip (coretemp, nvme, ...) providing monitor, index of chip amongst
+ * chips with the same name (coretemp.0, coretemp.1, ...) and path of device behind chip relative to sysfs
+ * root (stays the same when hwmon entries are renumbered, NULL if unknown).
  */
-struct mon_temp {
-    int real;
-    int max;
+struct mon_chip {
+    char *name;
+    int  id;
+    char *dev;
 };
 
 /**
@@ -42,56 +77,207 @@ struct mon_path {
 };
 
 /**
- * @brief Holds information about temperature monitor.
- * Struct holding id and hwmon entry id, current temperature and max temperature, path for reading temperature from
- * given monitor and its label.
+ * @brief Struct holding information about temperature monitor.
+ * Struct holding ids, chip, paths and label of monitor, which are not needed when reading temperatures.
  */
-typedef struct mon {
+struct mon_info {
     char            *lbl;
-    struct mon_path path;
     struct mon_id   id;
-    struct mon_temp temp;
-} t_mon;
+    struct mon_chip chip;
+    struct mon_path path;
+};
+
+/**
+ * @brief Struct holding alarms of monitors.
+ * Struct holding number of alarm files (tempN_max_alarm and tempN_crit_alarm), their poll
+ * descriptors waiting for POLLPRI (-1 while closed), index of monitor owning each alarm, state of
+ * each alarm, kind of each alarm (0 max, 1 crit) and number of currently raised alarms.
+ */
+struct mon_alrm {
+    int           cnt;
+    struct pollfd *fds;
+    int           *mon;
+    int           *on;
+    int           *sfx;
+    int           act;
+};
+
+/**
+ * @brief Struct holding CPU throttle counters.
+ * Struct holding number of open thermal throttle counters (core_throttle_count of first thread of every core
+ * and package_throttle_count of first CPU of every package), their handles, paths, kinds and last read values,
+ * number of throttle events of each kind counted since start (one thermal event usually raises both kinds),
+ * time of start and time of last throttle event (0 if none, both in microseconds, time_mono_us()).
+ */
+struct mon_thr {
+    int       cnt;
+    t_hnd     *hnd;
+    char      **path;
+    int       *last;
+    int       *kind;
+    long long evts[MON_THR_CNT];
+    long long start;
+    long long hit;
+};
+
+/**
+ * @brief Table of temperature monitors.
+ * Table holding number of monitors and parallel arrays of their current and max temperatures
+ * (in millidegrees), flags, health state, handles kept open for reading current temperature and
+ * information. Health state is number of consecutive failed reads, number of polls to skip before
+ * next retry, last read value and monotonic time (in microseconds) when it last changed. Alarms of all monitors
+ * and CPU throttle counters are held separately. Monitor i is described by i-th member of every array.
+ */
+typedef struct mons {
+    int             cnt;
+    int             *temp;
+    int             *max;
+    int             *flags;
+    int             *fails;
+    int             *skip;
+    int             *last;
+    long long       *chg;
+    t_hnd           *hnd;
+    struct mon_info *info;
+    struct mon_alrm alrm;
+    struct mon_thr  thr;
+} t_mons;
+
+/**
+ * @brief Constructs table of system temperature monitors.
+ * Constructs table of temperature monitors of all chips in /sys/class/hwmon selected as sensor source
+ * in settings. For each monitor sets its ids, chip, current temperature to MON_TEMP_INV, temperature
+ * reading path and from appropiate system files loads its label and max temperature. Temperature reading
+ * file and alarm files (when chip provides them) of every monitor are opened once here. All arrays of table
+ * are allocated once.
+ * @return t_mons* NULL on error, pointer to table of temperature monitors otherwise (has to be freed by mons_free()).
+ */
+t_mons *mons_load(void);
+
+/**
+ * @brief Reads current temperatures of all monitors.
+ * Reads current temperature of every system monitor which is not waiting for retry using its open
+ * handle and finishes every read using mons_read_done().
+ * @param[in,out] mons Pointer to table of temperature monitors.
+ */
+void mons_read_temp(t_mons *const mons);
+
+/**
+ * @brief Checks whether reading of given monitor should be skipped.
+ * Checks whether given failing monitor still waits for its next retry and counts down its backoff.
+ * @param[in,out] mons Pointer to table of temperature monitors.
+ * @param[in]     i    Index of monitor in table.
+ * @return int 0 when monitor should be read this poll, 1 when it should be skipped.
+ */
+int mons_read_skip(t_mons *const mons, const int i);
+
+/**
+ * @brief Finishes reading of given monitor.
+ * Updates flags and health state of given monitor after reading of its temperature. Failed monitor has its
+ * handle closed (to be reopened by next read) and its next retry is scheduled with exponential backoff.
+ * Out of range reading or reading which did not change for long time while other monitor of the same chip changed
+ * (stuck) puts monitor into quarantine. Temperature of excluded monitor is set
+ * to MON_TEMP_INV. Only changes of health state are logged.
+ * @param[in,out] mons Pointer to table of temperature monitors.
+ * @param[in]     i    Index of monitor in table.
+ * @param[in]     ok   Boolean if reading succeeded.
+ */
+void mons_read_done(t_mons *const mons, const int i, const int ok);
+
+/**
+ * @brief Reads alarms of monitors.
+ * Reads state of alarms which were signaled by poll() (or all alarms when all is set), which also rearms them
+ * for next poll(). Alarm which fails to read is not polled anymore. Raising and clearing of alarms is logged.
+ * @param[in,out] mons Pointer to table of temperature monitors.
+ * @param[in]     all  Boolean if all alarms should be read.
+ * @return int number of currently raised alarms.
+ */
+int mons_read_alarm(t_mons *const mons, const int all);
+
+/**
+ * @brief Reads CPU throttle counters.
+ * Reads all CPU thermal throttle counters and adds their increase since last reading to throttle events
+ * of their kind. Counter which fails to read keeps its last value.
+ * @param[in,out] mons Pointer to table of temperature monitors.
+ * @param[in]     now  Current time in microseconds (time_mono_us()).
+ * @return int number of new throttle events (higher of core and package ones, as both count the same events).
+ */
+int mons_read_thr(t_mons *const mons, const long long now);
+
+/**
+ * @brief Detaches monitors of removed chip.
+ * Closes handles and alarms of every monitor of hwmon chip with given index, which was removed from system,
+ * and marks them MON_F_GONE, so they are excluded from control until their chip appears again.
+ * @param[in,out] mons Pointer to table of temperature monitors.
+ * @param[in]     hw   Index of hwmon chip.
+ * @return int number of detached monitors.
+ */
+int mons_hw_del(t_mons *const mons, const int hw);
 
 /**
- * @brief Constructs linked list of system temperature monitors.
- * Constructs generic linked list of all system temperature monitors. For each monitor sets its ids, 
- * current temperature to 0, temperature reading path and from appropiate system files loads 
- * its label and max temperature.
- * @return t_node* NULL on error, pointer to head of generic linked list of temperature monitors otherwise.
+ * @brief Attaches monitors of added chip.
+ * Finds name and device of hwmon chip with given index, which was added to system. Every gone monitor of the
+ * same chip is attached to it (its paths are rebuilt, handles and alarms reopened and health state reset). Chip
+ * is matched by its device, because module reload may renumber hwmon entries and swap indexes of chips with
+ * the same name. Chips with unknown device are matched by name and index. Monitors of other chips are not touched.
+ * @param[in,out] mons Pointer to table of temperature monitors.
+ * @param[in]     hw   Index of hwmon chip.
+ * @return int -1 on error, number of attached monitors otherwise.
  */
-t_node *mons_load(void);
+int mons_hw_add(t_mons *const mons, const int hw);
 
 /**
  * @brief Gets the current system temperature.
- * Gets the current system temperature, which is the highest value from current temperatures of all system monitors.
- * @param[in] monitors Pointer to head of linked list of temperature monitors.
- * @return int settings_get_value(SET_TEMP_HIGH) if reading at least one temperature failed, 
+ * Gets the current system temperature (in millidegrees), which is the highest value from current temperatures
+ * of all system monitors read by last mons_read_temp() or sweep.
+ * @param[in] mons Pointer to table of temperature monitors.
+ * @return int settings_get_value(SET_TEMP_HIGH) (in millidegrees) if reading all temperatures failed,
  * current system temperature otherwise.
  */
-int mons_read_temp(t_node *mons);
+int mons_get_temp(const t_mons *const mons);
 
 /**
  * @brief Gets the system max allowed temperature
- * Gets the system max allowed temperature which is the lowest value of monitor.temp_max amongst all
- * system temperature monitors.
- * @param[in] monitors Pointer to head of linked list of temperature monitors.
- * @return int -1 on error, system max temperature otherwise.
+ * Gets the system max allowed temperature which is the lowest value of max temperature amongst all
+ * system temperature monitors with known max temperature. Caller has to check it against other settings
+ * (see set_check()), because chips like nvme report max temperature lower than CPU.
+ * @param[in] mons Pointer to table of temperature monitors.
+ * @return int -1 on error or when no max temperature is known, system max temperature otherwise.
+ */
+int mons_read_temp_max(const t_mons *const mons);
+
+/**
+ * @brief Frees memory for given table of monitors.
+ * Closes all reading handles and calls free() on all members of table and table itself.
+ * @param[in] mons Pointer to table of temperature monitors.
+ */
+void mons_free(t_mons *mons);
+
+/**
+ * @brief Prints info about monitors.
+ * Prints formated information about every monitor in given table to given file.
+ * @param[in] mons Pointer to table of temperature monitors.
+ * @param[in] file File to which is info printed.
  */
-int mons_read_temp_max(const t_node *mons);
+void mons_print(const t_mons *const mons, FILE *const file);
 
 /**
- * @brief Frees memory for given monitor.
- * Calls free() on members of monitor if they are not NULL.
- * @param[in] monitor Pointer to temperature monitor.
+ * @brief Prints excluded monitors.
+ * Prints every monitor currently excluded from control (failing, quarantined or gone) with reason
+ * of exclusion to given file.
+ * @param[in] mons Pointer to table of temperature monitors.
+ * @param[in] file File to which is info printed.
  */
-void mon_free(t_mon *mon, int self);
+void mons_print_excl(const t_mons *const mons, FILE *const file);
 
 /**
- * @brief Prints info about monitor.
- * Prints formated information (all values of t_mon) about given monitor to stdout.
- * @param[in] monitor Pointer to temperature monitor.
+ * @brief Prints info about CPU throttling.
+ * Prints number of CPU throttle counters, core and package throttle events since start, throttle events per hour
+ * and time since last throttle event to given file.
+ * @param[in] mons Pointer to table of temperature monitors.
+ * @param[in] now  Current time in microseconds (time_mono_us()).
+ * @param[in] file File to which is info printed.
  */
-void mon_print(const t_mon *const mon, FILE *const file);
+void mons_print_thr(const t_mons *const mons, const long long now, FILE *const file);
 
 #endif //MACFAND_MONITOR_H_fajkdsfbua
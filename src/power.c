@@ -0,0 +1,296 @@
+/**
+ * macfand - hipuranyhou - 16.10.2026
+ *
+ * Daemon for controlling fans on Linux systems using
+ * applesmc and coretemp.
+ *
+ * https://github.com/Hipuranyhou/macfand
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <fcntl.h>
+
+#include "power.h"
+#include "helper.h"
+#include "settings.h"
+#include "logger.h"
+
+#define PWR_PATH_CLS    "/class/powercap"
+#define PWR_PATH_PKG    "intel-rapl:"
+#define PWR_PATH_FMT    "%s" PWR_PATH_CLS "/%s/%s"
+#define PWR_PATH_ENERGY "energy_uj"
+#define PWR_PATH_RANGE  "max_energy_range_uj"
+#define PWR_PATH_STAT   "/proc/stat"
+#define PWR_STAT_SIZE   256
+
+/**
+ * @brief Filters out entries not being RAPL package.
+ * Filters out entries of powercap class not being top level RAPL zone (intel-rapl:N, not its subzones
+ * intel-rapl:N:M) when using scandir().
+ * @param[in] dirent Pointer to dirent entry which filename we check.
+ * @return int 0 on not package, 1 on package.
+ */
+static int pwr_load_filter(const struct dirent *dirent);
+
+/**
+ * @brief Reads long integer.
+ * Reads long integer value (energies do not fit into int) of attribute using given handle.
+ * @param[in,out] hnd  Pointer to handle.
+ * @param[out]    dest Address of destination.
+ * @return int 0 on error, 1 on success.
+ */
+static int pwr_read_ll(t_hnd *const hnd, long long *const dest);
+
+/**
+ * @brief Opens RAPL package.
+ * Opens energy counter of RAPL package with given name, reads its range and current energy and adds it
+ * to packages of given feed-forward inputs.
+ * @param[in,out] pwr  Pointer to feed-forward inputs.
+ * @param[in]     name Name of package in powercap class.
+ * @return int 0 if package can not be read (or on error), 1 on success.
+ */
+static int pwr_load_pkg(t_pwr *const pwr, const char *const name);
+
+/**
+ * @brief Reads CPU times.
+ * Reads busy and total time of all CPUs from first line of /proc/stat.
+ * @param[in,out] pwr   Pointer to feed-forward inputs.
+ * @param[out]    busy  Address where busy time is saved.
+ * @param[out]    total Address where total time is saved.
+ * @return int 0 on error, 1 on success.
+ */
+static int pwr_read_stat(t_pwr *const pwr, long long *const busy, long long *const total);
+
+/**
+ * @brief Maps input onto fan output.
+ * Maps given value linearly onto 0 - 1 between given low and high bound.
+ * @param[in] val  Value of input.
+ * @param[in] low  Value mapped onto 0.
+ * @param[in] high Value mapped onto 1 (0 disables input).
+ * @return double 0 if input is disabled, mapped value otherwise.
+ */
+static double pwr_map(const double val, const int low, const int high);
+
+
+static int pwr_load_filter(const struct dirent *dirent) {
+    return (strncmp(dirent->d_name, PWR_PATH_PKG, strlen(PWR_PATH_PKG)) == 0 &&
+            !strchr(dirent->d_name + strlen(PWR_PATH_PKG), ':'));
+}
+
+
+static int pwr_read_ll(t_hnd *const hnd, long long *const dest) {
+    char    buf[HND_BUF_SIZE];
+    char    *end   = NULL;
+    ssize_t rd_ret = 0;
+
+    rd_ret = hnd_read(hnd, buf, sizeof(buf));
+    if (rd_ret < 1)
+        return 0;
+
+    *dest = strtoll(buf, &end, 10);
+    return (end != buf && (*end == '\n' || *end == '\0'));
+}
+
+
+static int pwr_load_pkg(t_pwr *const pwr, const char *const name) {
+    t_hnd hnd;
+    char  *path = NULL;
+    int   ret   = 0;
+
+    // Counter wraps around at its range
+    path = concat_fmt(PWR_PATH_FMT, set_get_str(SET_SYSFS_ROOT), name, PWR_PATH_RANGE);
+    if (!path)
+        return 0;
+    if (hnd_open(&hnd, path, O_RDONLY)) {
+        ret = pwr_read_ll(&hnd, &(pwr->range[pwr->cnt]));
+        hnd_close(&hnd);
+    }
+    free(path);
+    if (!ret)
+        return 0;
+
+    path = concat_fmt(PWR_PATH_FMT, set_get_str(SET_SYSFS_ROOT), name, PWR_PATH_ENERGY);
+    if (!path)
+        return 0;
+    if (!hnd_open(&(pwr->hnd[pwr->cnt]), path, O_RDONLY) || !pwr_read_ll(&(pwr->hnd[pwr->cnt]), &(pwr->last[pwr->cnt]))) {
+        log_log(LOG_L_DEBUG, "Unable to read energy of RAPL package %s", name);
+        hnd_close(&(pwr->hnd[pwr->cnt]));
+        free(path);
+        return 0;
+    }
+
+    pwr->path[pwr->cnt] = path;
+    pwr->cnt++;
+    return 1;
+}
+
+
+static int pwr_read_stat(t_pwr *const pwr, long long *const busy, long long *const total) {
+    char      buf[PWR_STAT_SIZE];
+    long long vals[8];
+    int       i     = 0;
+
+    if (hnd_read(&(pwr->stat), buf, sizeof(buf)) < 1)
+        return 0;
+
+    // user nice system idle iowait irq softirq steal
+    if (sscanf(buf, "cpu %lld %lld %lld %lld %lld %lld %lld %lld", &vals[0], &vals[1], &vals[2], &vals[3],
+               &vals[4], &vals[5], &vals[6], &vals[7]) != 8)
+        return 0;
+
+    for (*total = 0, i = 0; i < 8; i++)
+        *total += vals[i];
+    *busy = *total - vals[3] - vals[4];
+
+    return 1;
+}
+
+
+static double pwr_map(const double val, const int low, const int high) {
+    if (high <= low || val <= low)
+        return 0;
+    if (val >= high)
+        return 1;
+    return (val - low) / (high - low);
+}
+
+
+t_pwr *pwr_load(void) {
+    t_pwr         *pwr       = NULL;
+    struct dirent **names    = NULL;
+    int           names_size = 0;
+    int           i          = 0;
+    char          *dir       = NULL;
+
+    pwr = (t_pwr*)calloc(1, sizeof(*pwr));
+    if (!pwr)
+        return NULL;
+
+    pwr->stat.fd = -1;
+    if (!hnd_open(&(pwr->stat), PWR_PATH_STAT, O_RDONLY))
+        log_log(LOG_L_DEBUG, "Unable to open %s", PWR_PATH_STAT);
+
+    dir = concat_fmt("%s%s", set_get_str(SET_SYSFS_ROOT), PWR_PATH_CLS);
+    names_size = (dir) ? scandir(dir, &names, pwr_load_filter, alphasort) : -1;
+    free(dir);
+    if (names_size < 1) {
+        if (names_size == 0)
+            free(names);
+        log_log(LOG_L_DEBUG, "%s", "No RAPL packages found");
+        return pwr;
+    }
+
+    pwr->hnd = (t_hnd*)malloc(names_size * sizeof(*(pwr->hnd)));
+    pwr->path = (char**)malloc(names_size * sizeof(*(pwr->path)));
+    pwr->last = (long long*)malloc(2 * names_size * sizeof(*(pwr->last)));
+    if (!pwr->hnd || !pwr->path || !pwr->last) {
+        free_dirent_names(names, names_size);
+        pwr_free(pwr);
+        return NULL;
+    }
+    pwr->range = pwr->last + names_size;
+
+    for (i = 0; i < names_size; i++)
+        pwr_load_pkg(pwr, names[i]->d_name);
+
+    free_dirent_names(names, names_size);
+
+    if (pwr->cnt > 0)
+        log_log(LOG_L_INFO, "Using %d RAPL packages for feed-forward", pwr->cnt);
+
+    return pwr;
+}
+
+
+int pwr_read(t_pwr *const pwr, const long long now) {
+    long long energy = 0;
+    long long uj     = 0;
+    long long busy   = 0;
+    long long total  = 0;
+    int       ret    = 1;
+    int       i      = 0;
+
+    if (!pwr)
+        return 0;
+
+    for (i = 0; i < pwr->cnt; i++) {
+        if (!pwr_read_ll(&(pwr->hnd[i]), &energy)) {
+            ret = 0;
+            continue;
+        }
+        uj += (energy >= pwr->last[i]) ? energy - pwr->last[i] : energy + pwr->range[i] - pwr->last[i];
+        pwr->last[i] = energy;
+    }
+
+    if (pwr->time > 0 && now > pwr->time)
+        pwr->watts = (double)uj / (now - pwr->time);
+    pwr->time = now;
+
+    if (!pwr_read_stat(pwr, &busy, &total))
+        return 0;
+
+    if (total > pwr->total && busy >= pwr->busy && pwr->total > 0)
+        pwr->load = 100.0 * (busy - pwr->busy) / (total - pwr->total);
+    pwr->busy = busy;
+    pwr->total = total;
+
+    return ret;
+}
+
+
+void pwr_reset(t_pwr *const pwr) {
+    if (!pwr)
+        return;
+
+    pwr->time = 0;
+    pwr->total = 0;
+    pwr->busy = 0;
+    pwr->watts = 0;
+    pwr->load = 0;
+}
+
+
+double pwr_get_feed(const t_pwr *const pwr) {
+    double power = 0;
+    double load  = 0;
+
+    if (!pwr)
+        return 0;
+
+    power = pwr_map(pwr->watts, set_get_int(SET_FEED_POWER_LOW), set_get_int(SET_FEED_POWER_HIGH));
+    load = pwr_map(pwr->load, set_get_int(SET_FEED_LOAD_LOW), set_get_int(SET_FEED_LOAD_HIGH));
+
+    return (power > load) ? power : load;
+}
+
+
+void pwr_free(t_pwr *pwr) {
+    int i = 0;
+
+    if (!pwr)
+        return;
+
+    for (i = 0; i < pwr->cnt; i++) {
+        hnd_close(&(pwr->hnd[i]));
+        free(pwr->path[i]);
+    }
+    hnd_close(&(pwr->stat));
+
+    free(pwr->hnd);
+    free(pwr->path);
+    free(pwr->last);
+    free(pwr);
+}
+
+
+void pwr_print(const t_pwr *const pwr, FILE *const file) {
+    if (!pwr || !file)
+        return;
+
+    fprintf(file, "RAPL packages: %d\n", pwr->cnt);
+    fprintf(file, "Package power: %.1f W\n", pwr->watts);
+    fprintf(file, "CPU utilization: %.1f %%\n", pwr->load);
+    fprintf(file, "Feed-forward output: %.0f %%\n", pwr_get_feed(pwr) * 100);
+}
@@ -0,0 +1,89 @@
+/**
+ * macfand - hipuranyhou - 16.10.2026
+ *
+ * Daemon for controlling fans on Linux systems using
+ * applesmc and coretemp.
+ *
+ * https://github.com/Hipuranyhou/macfand
+ */
+
+#ifndef MACFAND_POWER_H_tuvqmwlrea
+#define MACFAND_POWER_H_tuvqmwlrea
+
+#include <stdio.h>
+
+#include "handle.h"
+
+/**
+ * @brief Feed-forward inputs type.
+ * Type holding inputs of feed-forward, which are number of RAPL packages with their energy handles, paths,
+ * last read energies and energy ranges (in microjoules), handle of /proc/stat with last read busy and total
+ * CPU time (in ticks), time of last sample (0 if none, in microseconds, time_mono_us()), package power
+ * (in watts) and CPU utilization (in percent) computed from last two samples.
+ */
+typedef struct pwr {
+    int       cnt;
+    t_hnd     *hnd;
+    char      **path;
+    long long *last;
+    long long *range;
+    t_hnd     stat;
+    long long busy;
+    long long total;
+    long long time;
+    double    watts;
+    double    load;
+} t_pwr;
+
+/**
+ * @brief Constructs feed-forward inputs.
+ * Opens energy counters of all RAPL packages in /sys/class/powercap and /proc/stat. Missing RAPL (non-Intel
+ * CPU, no powercap) leaves only utilization.
+ * @return t_pwr* NULL on error, pointer to feed-forward inputs otherwise (has to be freed by pwr_free()).
+ */
+t_pwr *pwr_load(void);
+
+/**
+ * @brief Samples feed-forward inputs.
+ * Reads energy counters and CPU times and computes package power and CPU utilization over time elapsed since
+ * previous sample. First sample (and sample after pwr_reset()) only sets base for next one.
+ * @param[in,out] pwr Pointer to feed-forward inputs.
+ * @param[in]     now Current time in microseconds (time_mono_us()).
+ * @return int 0 on error, 1 on success.
+ */
+int pwr_read(t_pwr *const pwr, const long long now);
+
+/**
+ * @brief Forgets last sample.
+ * Forgets last sample of given feed-forward inputs and zeroes power and utilization, so next pwr_read() only
+ * sets base for next one. Used while feed-forward is disabled.
+ * @param[in,out] pwr Pointer to feed-forward inputs.
+ */
+void pwr_reset(t_pwr *const pwr);
+
+/**
+ * @brief Gets feed-forward fan output.
+ * Gets fraction of fan speed range (0 - 1) asked by feed-forward. Package power is mapped linearly between
+ * settings->feed_power_low and settings->feed_power_high, CPU utilization between settings->feed_load_low and
+ * settings->feed_load_high (input with high set to 0 is disabled) and higher one is used.
+ * @param[in] pwr Pointer to feed-forward inputs.
+ * @return double fraction of fan speed range asked by feed-forward.
+ */
+double pwr_get_feed(const t_pwr *const pwr);
+
+/**
+ * @brief Frees memory for given feed-forward inputs.
+ * Closes all handles and calls free() on all members of feed-forward inputs and on itself.
+ * @param[in] pwr Pointer to feed-forward inputs.
+ */
+void pwr_free(t_pwr *pwr);
+
+/**
+ * @brief Prints info about feed-forward inputs.
+ * Prints number of RAPL packages, package power, CPU utilization and feed-forward output to given file.
+ * @param[in] pwr  Pointer to feed-forward inputs.
+ * @param[in] file File to which is info printed.
+ */
+void pwr_print(const t_pwr *const pwr, FILE *const file);
+
+#endif //MACFAND_POWER_H_tuvqmwlrea
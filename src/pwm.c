@@ -0,0 +1,462 @@
+/**
+ * macfand - hipuranyhou - 16.10.2026
+ *
+ * Daemon for controlling fans on Linux systems using
+ * applesmc and coretemp.
+ *
+ * https://github.com/Hipuranyhou/macfand
+ */
+
+#include <dirent.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "pwm.h"
+#include "helper.h"
+#include "logger.h"
+#include "settings.h"
+
+#define PWM_PATH_CLS  "%s/class/hwmon"
+#define PWM_PATH_HW   PWM_PATH_CLS "/hwmon%d"
+#define PWM_PATH_NAME PWM_PATH_HW "/name"
+#define PWM_PATH_WR   PWM_PATH_HW "/pwm%d"
+#define PWM_PATH_MOD  PWM_PATH_WR "_enable"
+#define PWM_PATH_FAN  PWM_PATH_HW "/fan%d_%s"
+#define PWM_PATH_RD   "input"
+#define PWM_PATH_LBL  "label"
+#define PWM_NAME_SIZE 64
+#define PWM_DUTY_MAX  255
+#define PWM_SPD_MAX   10000
+#define PWM_MOD_MAN   1
+
+/**
+ * @brief Struct holding pwm output.
+ * Struct holding id of hwmon entry of chip, name of chip and number of pwm output found by discovery.
+ */
+struct pwm_out {
+    int  hw;
+    char name[PWM_NAME_SIZE];
+    int  pwm;
+};
+
+/**
+ * @brief Reads string attribute.
+ * Reads content of attribute at given path into given buffer without trailing newline.
+ * @param[in]  path     Path to attribute.
+ * @param[out] buf      Destination buffer.
+ * @param[in]  buf_size Size of destination buffer.
+ * @return int 0 on error, 1 on success.
+ */
+static int pwm_read_str(const char *const path, char *const buf, const size_t buf_size);
+
+/**
+ * @brief Checks whether given chip is selected.
+ * Checks whether name of given chip starts with any item of comma separated list in settings->pwm_chips
+ * or the list holds "all".
+ * @param[in] name Name of chip.
+ * @return int 0 on not selected, 1 on selected.
+ */
+static int pwm_sel_chip(const char *const name);
+
+/**
+ * @brief Filters out files not starting filename with "hwmon".
+ * Filters out files not starting filename with "hwmon" when using scandir().
+ * @param[in] dirent Pointer to dirent entry which filename we check.
+ * @return int 0 on not starting, 1 on starting.
+ */
+static int pwm_load_hw_filter(const struct dirent *dirent);
+
+/**
+ * @brief Filters out files which are not pwm outputs.
+ * Filters out files which are not "pwm" followed only by number when using scandir().
+ * @param[in] dirent Pointer to dirent entry which filename we check.
+ * @return int 0 on not pwm output, 1 on pwm output.
+ */
+static int pwm_load_out_filter(const struct dirent *dirent);
+
+/**
+ * @brief Compares entries by their number.
+ * Compares hwmon entries or pwm outputs by number following their prefix, so hwmon10 comes after hwmon2.
+ * @param[in] a Pointer to first dirent entry.
+ * @param[in] b Pointer to second dirent entry.
+ * @return int Negative, zero or positive if a is lower, same or higher than b.
+ */
+static int pwm_load_cmp(const struct dirent **a, const struct dirent **b);
+
+/**
+ * @brief Finds pwm outputs of given chip.
+ * Appends every pwm output of given chip which has pwmN_enable and fanN_input to given array of outputs,
+ * which is resized when needed.
+ * @param[in,out] outs Address of array of outputs.
+ * @param[in,out] cnt  Address of number of outputs in array.
+ * @param[in,out] cap  Address of capacity of array.
+ * @param[in]     hw   Id of hwmon entry of chip.
+ * @param[in]     name Name of chip.
+ * @return int 0 on error, 1 on success.
+ */
+static int pwm_load_chip(struct pwm_out **outs, int *const cnt, int *const cap, const int hw,
+                         const char *const name);
+
+/**
+ * @brief Loads device path of given chip.
+ * Loads path of device behind hwmon entry of given chip relative to sysfs root, as it appears in uevents.
+ * @param[in] hw Id of hwmon entry of chip.
+ * @return char* NULL on error, path of device otherwise (has to be freed).
+ */
+static char *pwm_load_dev(const int hw);
+
+/**
+ * @brief Loads default values for given fan.
+ * Constructs reading, writing and mode setting paths of fan driven by given pwm output, loads mode it is in,
+ * its label (chip name and output when chip has no label for it), speed limits from settings and finishes
+ * it using fan_load().
+ * @param[in,out] fan Pointer to fan to be loaded.
+ * @param[in]     out Pointer to pwm output.
+ * @return int 0 on error, 1 on success.
+ */
+static int pwm_load_def(t_fan *const fan, const struct pwm_out *const out);
+
+/**
+ * @brief Discovers pwm fans.
+ * Constructs generic linked list of fans driven by pwm outputs of all selected hwmon chips. Fans are numbered
+ * from 1 in order of hwmon entries and outputs.
+ * @return t_node* NULL if selected chips have no pwm outputs (or on error), pointer to head of generic linked
+ * list of system fans otherwise.
+ */
+static t_node *pwm_load(void);
+
+/**
+ * @brief Sets mode of pwm fan.
+ * Sets given fan to manual mode, or restores mode it was in before macfand took control. Fan which already was
+ * in manual mode is left at full speed.
+ * @param[in,out] fan Pointer to fan.
+ * @param[in]     mod Mode to which should fan be set.
+ * @return int 0 on error, 1 on success.
+ */
+static int pwm_write_mod(t_fan *const fan, const enum fan_mode mod);
+
+/**
+ * @brief Sets speed of pwm fan.
+ * Writes given speed (duty cycle in basis points) of given fan scaled to pwm range.
+ * @param[in,out] fan Pointer to fan.
+ * @param[in]     spd Speed in basis points.
+ * @return int 0 on error, 1 on success.
+ */
+static int pwm_write_spd(t_fan *const fan, const int spd);
+
+
+const struct fan_bknd pwm_bknd = {
+    .name = "pwm",
+    .unit = "bp",
+    .rpm = 0,
+    .load = pwm_load,
+    .write_mod = pwm_write_mod,
+    .write_spd = pwm_write_spd
+};
+
+
+static int pwm_read_str(const char *const path, char *const buf, const size_t buf_size) {
+    t_hnd   hnd;
+    ssize_t rd_ret = 0;
+
+    if (!path || !hnd_open(&hnd, path, O_RDONLY))
+        return 0;
+
+    rd_ret = hnd_read(&hnd, buf, buf_size);
+    hnd_close(&hnd);
+    if (rd_ret < 2)
+        return 0;
+
+    // Remove trailing '\n'
+    if (buf[rd_ret-1] == '\n')
+        buf[rd_ret-1] = '\0';
+
+    return 1;
+}
+
+
+static int pwm_sel_chip(const char *const name) {
+    const char *sel = set_get_str(SET_PWM_CHIPS);
+    const char *end = NULL;
+    size_t     tok  = 0;
+
+    if (!sel)
+        return 0;
+
+    while (*sel) {
+        // Skip separators
+        while (isspace(*sel) || *sel == ',')
+            sel++;
+
+        end = sel;
+        while (*end && *end != ',' && !isspace(*end))
+            end++;
+        tok = end - sel;
+
+        if (tok == 3 && strncmp(sel, "all", 3) == 0)
+            return 1;
+        if (tok > 0 && strncmp(sel, name, tok) == 0)
+            return 1;
+
+        sel = end;
+    }
+
+    return 0;
+}
+
+
+static int pwm_load_hw_filter(const struct dirent *dirent) {
+    return (strncmp(dirent->d_name, "hwmon", 5) == 0);
+}
+
+
+static int pwm_load_out_filter(const struct dirent *dirent) {
+    int id = 0;
+
+    return (strncmp(dirent->d_name, "pwm", 3) == 0 && str_to_int(dirent->d_name+3, &id, 10, NULL) == 1);
+}
+
+
+static int pwm_load_cmp(const struct dirent **a, const struct dirent **b) {
+    int  a_id = 0;
+    int  b_id = 0;
+    char *a_num = strpbrk((*a)->d_name, "0123456789");
+    char *b_num = strpbrk((*b)->d_name, "0123456789");
+
+    if (a_num)
+        str_to_int(a_num, &a_id, 10, NULL);
+    if (b_num)
+        str_to_int(b_num, &b_id, 10, NULL);
+
+    return (a_id > b_id) - (a_id < b_id);
+}
+
+
+static int pwm_load_chip(struct pwm_out **outs, int *const cnt, int *const cap, const int hw,
+                         const char *const name) {
+    const char     *root      = set_get_str(SET_SYSFS_ROOT);
+    struct dirent  **names    = NULL;
+    int            names_size = 0;
+    int            i          = 0;
+    int            pwm        = 0;
+    char           *dir       = NULL;
+    char           *mod       = NULL;
+    char           *rd        = NULL;
+    struct pwm_out *out       = NULL;
+    int            ret        = 1;
+
+    dir = concat_fmt(PWM_PATH_HW, root, hw);
+    if (!dir)
+        return 0;
+
+    errno = 0;
+    names_size = scandir(dir, &names, pwm_load_out_filter, pwm_load_cmp);
+    free(dir);
+    if (names_size < 0) {
+        log_log(LOG_L_DEBUG, "Unable to open directory of hwmon%d.", hw);
+        return 0;
+    }
+
+    for (i = 0; i < names_size && ret; i++) {
+        str_to_int(names[i]->d_name+3, &pwm, 10, NULL);
+
+        // Outputs without mode control or tachometer cannot be driven
+        mod = concat_fmt(PWM_PATH_MOD, root, hw, pwm);
+        rd = concat_fmt(PWM_PATH_FAN, root, hw, pwm, PWM_PATH_RD);
+        if (!mod || !rd)
+            ret = 0;
+        else if (access(mod, R_OK | W_OK) < 0 || access(rd, R_OK) < 0)
+            log_log(LOG_L_DEBUG, "Skipping pwm%d of %s (hwmon%d) without mode control or tachometer", pwm, name, hw);
+        else {
+            // Resize array of outputs
+            if (*cnt == *cap) {
+                out = (struct pwm_out*)realloc(*outs, (*cap * 2 + 4) * sizeof(*out));
+                if (!out)
+                    ret = 0;
+                else {
+                    *outs = out;
+                    *cap = *cap * 2 + 4;
+                }
+            }
+            if (ret) {
+                out = &((*outs)[(*cnt)++]);
+                out->hw = hw;
+                out->pwm = pwm;
+                strcpy(out->name, name);
+            }
+        }
+
+        free(mod);
+        free(rd);
+    }
+
+    free_dirent_names(names, names_size);
+    return ret;
+}
+
+
+static char *pwm_load_dev(const int hw) {
+    const char *root    = set_get_str(SET_SYSFS_ROOT);
+    char       *path    = NULL;
+    char       *real    = NULL;
+    char       *base    = NULL;
+    char       *dev     = NULL;
+    size_t     base_len = 0;
+
+    path = concat_fmt(PWM_PATH_HW, root, hw);
+    if (!path)
+        return NULL;
+
+    // Entries of hwmon class are symlinks into device tree
+    real = realpath(path, NULL);
+    base = realpath(root, NULL);
+    free(path);
+    if (real && base) {
+        base_len = strlen(base);
+        if (strncmp(real, base, base_len) == 0 && real[base_len] == '/')
+            dev = concat_fmt("%s", real + base_len);
+    }
+
+    free(real);
+    free(base);
+    return dev;
+}
+
+
+static int pwm_load_def(t_fan *const fan, const struct pwm_out *const out) {
+    const char *root = set_get_str(SET_SYSFS_ROOT);
+    char       *path = NULL;
+    char       lbl[PWM_NAME_SIZE];
+    t_hnd      hnd;
+
+    if (!fan || !out)
+        return 0;
+
+    fan->bknd = &pwm_bknd;
+
+    // Load all paths of given fan
+    fan->path.rd = concat_fmt(PWM_PATH_FAN, root, out->hw, out->pwm, PWM_PATH_RD);
+    fan->path.wr = concat_fmt(PWM_PATH_WR, root, out->hw, out->pwm);
+    fan->path.mod = concat_fmt(PWM_PATH_MOD, root, out->hw, out->pwm);
+    fan->path.dev = pwm_load_dev(out->hw);
+    if (!fan->path.rd || !fan->path.wr || !fan->path.mod) {
+        log_log(LOG_L_DEBUG, "Unable to load read, write or mode path of fan %d", fan->id);
+        return 0;
+    }
+    if (!fan->path.dev)
+        log_log(LOG_L_DEBUG, "Unable to load device of fan %d, it is not recovered on hotplug", fan->id);
+
+    // Mode is restored on exit
+    if (!hnd_open(&hnd, fan->path.mod, O_RDONLY) || !hnd_read_int(&hnd, &(fan->mod))) {
+        log_log(LOG_L_DEBUG, "Unable to load mode of fan %d", fan->id);
+        hnd_close(&hnd);
+        return 0;
+    }
+    hnd_close(&hnd);
+
+    fan->spd.min = set_get_int(SET_PWM_MIN) * (PWM_SPD_MAX / 100);
+    fan->spd.max = PWM_SPD_MAX;
+
+    // Load fan label
+    path = concat_fmt(PWM_PATH_FAN, root, out->hw, out->pwm, PWM_PATH_LBL);
+    if (path && pwm_read_str(path, lbl, sizeof(lbl)))
+        fan->lbl = concat_fmt("%s", lbl);
+    else
+        fan->lbl = concat_fmt("%s pwm%d", out->name, out->pwm);
+    free(path);
+    if (!fan->lbl) {
+        log_log(LOG_L_DEBUG, "Unable to load label of fan %d", fan->id);
+        return 0;
+    }
+
+    return fan_load(fan);
+}
+
+
+static t_node *pwm_load(void) {
+    const char     *root      = set_get_str(SET_SYSFS_ROOT);
+    struct dirent  **names    = NULL;
+    int            names_size = 0;
+    struct pwm_out *outs      = NULL;
+    int            cnt        = 0;
+    int            cap        = 0;
+    int            hw         = 0;
+    int            i          = 0;
+    int            ok         = 1;
+    char           name[PWM_NAME_SIZE];
+    char           *path      = NULL;
+    t_fan          fan;
+    t_node         *fans      = NULL;
+
+    path = concat_fmt(PWM_PATH_CLS, root);
+    if (!path)
+        return NULL;
+
+    errno = 0;
+    names_size = scandir(path, &names, pwm_load_hw_filter, pwm_load_cmp);
+    if (names_size < 0) {
+        log_log(LOG_L_DEBUG, "Unable to open %s directory.", path);
+        free(path);
+        return NULL;
+    }
+    free(path);
+
+    // Find outputs of all selected chips first, so fans can be numbered in order
+    for (i = 0; i < names_size && ok; i++) {
+        if (str_to_int(names[i]->d_name+5, &hw, 10, NULL) < 1)
+            continue;
+
+        path = concat_fmt(PWM_PATH_NAME, root, hw);
+        if (path && pwm_read_str(path, name, sizeof(name)) && pwm_sel_chip(name))
+            ok = pwm_load_chip(&outs, &cnt, &cap, hw, name);
+        free(path);
+    }
+    free_dirent_names(names, names_size);
+
+    if (!ok) {
+        free(outs);
+        log_log(LOG_L_DEBUG, "%s", "Unable to find pwm outputs");
+        return NULL;
+    }
+
+    // Fans are pushed to front, so they are loaded from the last one
+    for (i = cnt - 1; i >= 0; i--) {
+        fan_clear(&fan);
+        fan.id = i + 1;
+
+        // Load fan defaults and append it to linked list of fans
+        if (!pwm_load_def(&fan, &(outs[i])) || !list_push_front(&fans, &fan, sizeof(fan))) {
+            list_free(fans, (void (*)(void *, int))fan_free);
+            fan_free(&fan, 0);
+            free(outs);
+            log_log(LOG_L_DEBUG, "Unable to load defaults of fan %d", fan.id);
+            return NULL;
+        }
+    }
+
+    free(outs);
+    return fans;
+}
+
+
+static int pwm_write_mod(t_fan *const fan, const enum fan_mode mod) {
+    if (mod == FAN_M_MAN)
+        return hnd_write_int(&(fan->hnd.mod), PWM_MOD_MAN);
+
+    // Fan which was in manual mode would keep last duty cycle
+    if (fan->mod == PWM_MOD_MAN)
+        return hnd_write_int(&(fan->hnd.wr), PWM_DUTY_MAX);
+
+    return hnd_write_int(&(fan->hnd.mod), fan->mod);
+}
+
+
+static int pwm_write_spd(t_fan *const fan, const int spd) {
+    int duty = (spd * PWM_DUTY_MAX + PWM_SPD_MAX / 2) / PWM_SPD_MAX;
+
+    return hnd_write_int(&(fan->hnd.wr), max(0, min(duty, PWM_DUTY_MAX)));
+}
@@ -0,0 +1,22 @@
+/**
+ * macfand - hipuranyhou - 16.10.2026
+ *
+ * Daemon for controlling fans on Linux systems using
+ * applesmc and coretemp.
+ *
+ * https://github.com/Hipuranyhou/macfand
+ */
+
+#ifndef MACFAND_PWM_H_xhtrnqbdoa
+#define MACFAND_PWM_H_xhtrnqbdoa
+
+#include "fan.h"
+
+/**
+ * @brief Generic hwmon pwm fan backend.
+ * Fan backend driving pwmN outputs of hwmon chips (nct6775, it87, ...) which have pwmN_enable and fanN_input.
+ * Speeds of its fans are duty cycles in basis points (0 - 10000), which are written as pwmN (0 - 255).
+ */
+extern const struct fan_bknd pwm_bknd;
+
+#endif //MACFAND_PWM_H_xhtrnqbdoa
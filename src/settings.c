@@ -8,16 +8,24 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
 #include <string.h>
 
 #include "settings.h"
 #include "logger.h"
+#include "control.h"
+#include "fan.h"
+
+#define SET_T_INT 0
+#define SET_T_DBL 1
+#define SET_T_STR 2
 
 /**
  * @brief Struct holding all settings.
  * Struct holding all settings with set defaults.
  */
-static struct {
+static struct set_vals {
     int temp_low;
     int temp_high;
     int temp_max;
@@ -29,28 +37,239 @@ static struct {
     int widget;
     char *widget_file_path;
     char *config_file_path;
+    int io_uring;
+    char *sensors;
+    char *status_file_path;
+    char *zones;
+    char *curve;
+    char *curve_fall;
+    int ctrl_mode;
+    int pid_target;
+    double pid_kp;
+    double pid_ki;
+    double pid_kd;
+    double pid_tau;
+    int mpc_ceiling;
+    int mpc_horizon;
+    int time_poll_idle;
+    int feed_power_low;
+    int feed_power_high;
+    int feed_load_low;
+    int feed_load_high;
+    int psi_stall;
+    int psi_window;
+    int fan_deadband;
+    int fan_dwell;
+    int fan_readback;
+    int fan_slew;
+    int fan_backend;
+    char *sysfs_root;
+    char *pwm_chips;
+    int pwm_min;
+    int fan_settle;
+    int fan_tolerance;
 } set = {
     .temp_low = 63,
     .temp_high = 66,
     .temp_max = 84,
-    .time_poll = 1,
+    .time_poll = 1000,
     .daemon = 0,
     .verbose = 0,
     .log_type = LOG_T_STD,
     .log_file_path = NULL,
     .widget = 0,
     .widget_file_path = NULL,
-    .config_file_path = NULL
+    .config_file_path = NULL,
+    .io_uring = 0,
+    .sensors = NULL,
+    .status_file_path = NULL,
+    .zones = NULL,
+    .curve = NULL,
+    .curve_fall = NULL,
+    .ctrl_mode = CTRL_M_CURVE,
+    .pid_target = 72,
+    .pid_kp = 0.08,
+    .pid_ki = 0.004,
+    .pid_kd = 0.1,
+    .pid_tau = 2,
+    .mpc_ceiling = 76,
+    .mpc_horizon = 10,
+    .time_poll_idle = 0,
+    .feed_power_low = 15,
+    .feed_power_high = 0,
+    .feed_load_low = 50,
+    .feed_load_high = 0,
+    .psi_stall = 0,
+    .psi_window = 1000,
+    .fan_deadband = 100,
+    .fan_dwell = 3000,
+    .fan_readback = 10,
+    .fan_slew = 0,
+    .fan_backend = FAN_B_AUTO,
+    .sysfs_root = NULL,
+    .pwm_chips = NULL,
+    .pwm_min = 20,
+    .fan_settle = 10000,
+    .fan_tolerance = 25
 };
 
+/**
+ * @brief Struct holding snapshot of settings.
+ * Struct holding copy of all settings saved by set_snap_save() and whether it is valid.
+ */
+static struct {
+    struct set_vals vals;
+    int             ok;
+} snap = {
+    .ok = 0
+};
+
+/**
+ * @brief Struct holding base of settings.
+ * Struct holding copy of default settings with command line overrides saved by set_base_save() and whether it
+ * is valid. Configuration file is reloaded on top of it.
+ */
+static struct {
+    struct set_vals vals;
+    int             ok;
+} base = {
+    .ok = 0
+};
+
+/**
+ * @brief Struct describing one setting.
+ * Struct holding name of setting (same as in configuration file), its type and offset in struct set_vals.
+ * Array of these is indexed by enum setting.
+ */
+static const struct set_desc {
+    const char *name;
+    int        type;
+    size_t     off;
+} set_descs[] = {
+    [SET_TEMP_LOW]         = {"temp_low", SET_T_INT, offsetof(struct set_vals, temp_low)},
+    [SET_TEMP_HIGH]        = {"temp_high", SET_T_INT, offsetof(struct set_vals, temp_high)},
+    [SET_TEMP_MAX]         = {"temp_max", SET_T_INT, offsetof(struct set_vals, temp_max)},
+    [SET_TIME_POLL]        = {"time_poll_ms", SET_T_INT, offsetof(struct set_vals, time_poll)},
+    [SET_DAEMON]           = {"daemon", SET_T_INT, offsetof(struct set_vals, daemon)},
+    [SET_VERBOSE]          = {"verbose", SET_T_INT, offsetof(struct set_vals, verbose)},
+    [SET_LOG_TYPE]         = {"log_type", SET_T_INT, offsetof(struct set_vals, log_type)},
+    [SET_LOG_FILE_PATH]    = {"log_file_path", SET_T_STR, offsetof(struct set_vals, log_file_path)},
+    [SET_WIDGET]           = {"widget", SET_T_INT, offsetof(struct set_vals, widget)},
+    [SET_WIDGET_FILE_PATH] = {"widget_file_path", SET_T_STR, offsetof(struct set_vals, widget_file_path)},
+    [SET_CONFIG_FILE_PATH] = {"config_file_path", SET_T_STR, offsetof(struct set_vals, config_file_path)},
+    [SET_IO_URING]         = {"io_uring", SET_T_INT, offsetof(struct set_vals, io_uring)},
+    [SET_SENSORS]          = {"sensors", SET_T_STR, offsetof(struct set_vals, sensors)},
+    [SET_STATUS_FILE_PATH] = {"status_file_path", SET_T_STR, offsetof(struct set_vals, status_file_path)},
+    [SET_ZONES]            = {"zones", SET_T_STR, offsetof(struct set_vals, zones)},
+    [SET_CURVE]            = {"curve", SET_T_STR, offsetof(struct set_vals, curve)},
+    [SET_CURVE_FALL]       = {"curve_fall", SET_T_STR, offsetof(struct set_vals, curve_fall)},
+    [SET_CTRL_MODE]        = {"ctrl_mode", SET_T_INT, offsetof(struct set_vals, ctrl_mode)},
+    [SET_PID_TARGET]       = {"pid_target", SET_T_INT, offsetof(struct set_vals, pid_target)},
+    [SET_PID_KP]           = {"pid_kp", SET_T_DBL, offsetof(struct set_vals, pid_kp)},
+    [SET_PID_KI]           = {"pid_ki", SET_T_DBL, offsetof(struct set_vals, pid_ki)},
+    [SET_PID_KD]           = {"pid_kd", SET_T_DBL, offsetof(struct set_vals, pid_kd)},
+    [SET_PID_TAU]          = {"pid_tau", SET_T_DBL, offsetof(struct set_vals, pid_tau)},
+    [SET_MPC_CEILING]      = {"mpc_ceiling", SET_T_INT, offsetof(struct set_vals, mpc_ceiling)},
+    [SET_MPC_HORIZON]      = {"mpc_horizon", SET_T_INT, offsetof(struct set_vals, mpc_horizon)},
+    [SET_TIME_POLL_IDLE]   = {"time_poll_idle_ms", SET_T_INT, offsetof(struct set_vals, time_poll_idle)},
+    [SET_FEED_POWER_LOW]   = {"feed_power_low", SET_T_INT, offsetof(struct set_vals, feed_power_low)},
+    [SET_FEED_POWER_HIGH]  = {"feed_power_high", SET_T_INT, offsetof(struct set_vals, feed_power_high)},
+    [SET_FEED_LOAD_LOW]    = {"feed_load_low", SET_T_INT, offsetof(struct set_vals, feed_load_low)},
+    [SET_FEED_LOAD_HIGH]   = {"feed_load_high", SET_T_INT, offsetof(struct set_vals, feed_load_high)},
+    [SET_PSI_STALL]        = {"psi_stall_ms", SET_T_INT, offsetof(struct set_vals, psi_stall)},
+    [SET_PSI_WINDOW]       = {"psi_window_ms", SET_T_INT, offsetof(struct set_vals, psi_window)},
+    [SET_FAN_DEADBAND]     = {"fan_deadband", SET_T_INT, offsetof(struct set_vals, fan_deadband)},
+    [SET_FAN_DWELL]        = {"fan_dwell_ms", SET_T_INT, offsetof(struct set_vals, fan_dwell)},
+    [SET_FAN_READBACK]     = {"fan_readback", SET_T_INT, offsetof(struct set_vals, fan_readback)},
+    [SET_FAN_SLEW]         = {"fan_slew", SET_T_INT, offsetof(struct set_vals, fan_slew)},
+    [SET_FAN_BACKEND]      = {"fan_backend", SET_T_INT, offsetof(struct set_vals, fan_backend)},
+    [SET_SYSFS_ROOT]       = {"sysfs_root", SET_T_STR, offsetof(struct set_vals, sysfs_root)},
+    [SET_PWM_CHIPS]        = {"pwm_chips", SET_T_STR, offsetof(struct set_vals, pwm_chips)},
+    [SET_PWM_MIN]          = {"pwm_min", SET_T_INT, offsetof(struct set_vals, pwm_min)},
+    [SET_FAN_SETTLE]       = {"fan_settle_ms", SET_T_INT, offsetof(struct set_vals, fan_settle)},
+    [SET_FAN_TOLERANCE]    = {"fan_tolerance", SET_T_INT, offsetof(struct set_vals, fan_tolerance)}
+};
+
+#define SET_CNT ((int)(sizeof(set_descs) / sizeof(set_descs[0])))
+#define SET_PTR(vals, i, type) ((type*)((char*)(vals) + set_descs[i].off))
+
+/**
+ * @brief Checks given setting.
+ * Checks whether setting with given index exists and is of given type.
+ * @param[in] choice Index of setting from enum setting.
+ * @param[in] type   Expected type of setting (SET_T_INT, SET_T_DBL or SET_T_STR).
+ * @return int 0 if it does not, 1 otherwise.
+ */
+static int set_desc_ok(const int choice, const int type);
+
+/**
+ * @brief Frees strings of given settings.
+ * Calls free() on every string setting of given settings and sets it to NULL.
+ * @param[in,out] vals Pointer to settings.
+ */
+static void set_vals_free(struct set_vals *const vals);
+
+/**
+ * @brief Copies settings.
+ * Copies given settings including their strings.
+ * @param[out] dst Pointer to destination settings (its strings are overwritten, not freed).
+ * @param[in]  src Pointer to source settings.
+ * @return int 0 on error (no strings are allocated then), 1 on success.
+ */
+static int set_vals_copy(struct set_vals *const dst, const struct set_vals *const src);
+
+
+static int set_desc_ok(const int choice, const int type) {
+    return (choice >= 0 && choice < SET_CNT && set_descs[choice].type == type);
+}
+
+
+static void set_vals_free(struct set_vals *const vals) {
+    int i = 0;
+
+    for (i = 0; i < SET_CNT; i++) {
+        if (set_descs[i].type != SET_T_STR)
+            continue;
+        free(*SET_PTR(vals, i, char*));
+        *SET_PTR(vals, i, char*) = NULL;
+    }
+}
+
+
+static int set_vals_copy(struct set_vals *const dst, const struct set_vals *const src) {
+    const char *str = NULL;
+    int        i    = 0;
+
+    *dst = *src;
+
+    for (i = 0; i < SET_CNT; i++) {
+        if (set_descs[i].type != SET_T_STR)
+            continue;
+        *SET_PTR(dst, i, char*) = NULL;
+    }
+
+    for (i = 0; i < SET_CNT; i++) {
+        str = *SET_PTR(src, i, char*);
+        if (set_descs[i].type != SET_T_STR || !str)
+            continue;
+        *SET_PTR(dst, i, char*) = (char*)malloc(strlen(str)+1);
+        if (!*SET_PTR(dst, i, char*)) {
+            set_vals_free(dst);
+            return 0;
+        }
+        strcpy(*SET_PTR(dst, i, char*), str);
+    }
+
+    return 1;
+}
+
 
 void set_free() {
-    if (set.log_file_path)
-        free(set.log_file_path);
-    if (set.widget_file_path)
-        free(set.widget_file_path);
-    if (set.config_file_path)
-        free(set.config_file_path);
+    set_vals_free(&set);
+    set_snap_free();
+    if (base.ok)
+        set_vals_free(&(base.vals));
+    base.ok = 0;
 }
 
 
@@ -68,8 +287,12 @@ int set_check() {
         log_log(LOG_L_DEBUG, "%s", "Value of temp_max is invalid (must be > temp_high");
         return 0;
     }
-    if (set.time_poll < 1) {
-        log_log(LOG_L_DEBUG, "%s", "Value of time_poll must be >= 1");
+    if (set.time_poll < 100) {
+        log_log(LOG_L_DEBUG, "%s", "Value of time_poll must be >= 100 ms");
+        return 0;
+    }
+    if (set.time_poll_idle != 0 && set.time_poll_idle < set.time_poll) {
+        log_log(LOG_L_DEBUG, "%s", "Value of time_poll_idle is invalid (must be 0 or >= time_poll)");
         return 0;
     }
     if (set.daemon != 0 && set.daemon != 1) {
@@ -102,120 +325,297 @@ int set_check() {
         }
         log_log(LOG_L_INFO, "%s", "Using default widget file path /tmp/macfand.widget");
     }
+    if (set.io_uring != 0 && set.io_uring != 1) {
+        log_log(LOG_L_DEBUG, "%s", "Value of io_uring must be 0 or 1");
+        return 0;
+    }
+    if (!set.sensors) {
+        if (!set_set_str(SET_SENSORS, "coretemp")) {
+            log_log(LOG_L_DEBUG, "%s", "Unable to set default sensor sources to coretemp");
+            return 0;
+        }
+        log_log(LOG_L_INFO, "%s", "Using default sensor sources coretemp");
+    }
+    if (set.ctrl_mode < CTRL_M_CURVE || set.ctrl_mode > CTRL_M_MPC) {
+        log_log(LOG_L_DEBUG, "%s", "Value of ctrl_mode must be one of curve, pid and mpc");
+        return 0;
+    }
+    // Targets are unused (and may be out of range of temperatures) in other control modes
+    if (set.ctrl_mode == CTRL_M_PID && (set.pid_target < set.temp_low || set.pid_target >= set.temp_max)) {
+        log_log(LOG_L_DEBUG, "%s", "Value of pid_target is invalid (must be >= temp_low and < temp_max)");
+        return 0;
+    }
+    if (set.pid_kp < 0 || set.pid_ki < 0 || set.pid_kd < 0 || set.pid_tau < 0) {
+        log_log(LOG_L_DEBUG, "%s", "Values of pid_kp, pid_ki, pid_kd and pid_tau must be >= 0");
+        return 0;
+    }
+    if (set.ctrl_mode == CTRL_M_MPC && (set.mpc_ceiling <= set.temp_low || set.mpc_ceiling >= set.temp_max)) {
+        log_log(LOG_L_DEBUG, "%s", "Value of mpc_ceiling is invalid (must be > temp_low and < temp_max)");
+        return 0;
+    }
+    if (set.mpc_horizon < 1) {
+        log_log(LOG_L_DEBUG, "%s", "Value of mpc_horizon must be >= 1");
+        return 0;
+    }
+    if (set.feed_power_low < 0 || (set.feed_power_high != 0 && set.feed_power_high <= set.feed_power_low)) {
+        log_log(LOG_L_DEBUG, "%s", "Value of feed_power_high is invalid (must be 0 or > feed_power_low >= 0)");
+        return 0;
+    }
+    if (set.feed_load_low < 0 || set.feed_load_high > 100 ||
+        (set.feed_load_high != 0 && set.feed_load_high <= set.feed_load_low)) {
+        log_log(LOG_L_DEBUG, "%s", "Value of feed_load_high is invalid (must be 0 or > feed_load_low >= 0 and <= 100)");
+        return 0;
+    }
+    if (set.psi_window < 500 || set.psi_window > 10000) {
+        log_log(LOG_L_DEBUG, "%s", "Value of psi_window_ms must be >= 500 and <= 10000");
+        return 0;
+    }
+    if (set.psi_stall < 0 || set.psi_stall >= set.psi_window) {
+        log_log(LOG_L_DEBUG, "%s", "Value of psi_stall_ms is invalid (must be 0 or > 0 and < psi_window_ms)");
+        return 0;
+    }
+    if (set.fan_deadband < 0 || set.fan_dwell < 0) {
+        log_log(LOG_L_DEBUG, "%s", "Values of fan_deadband and fan_dwell_ms must be >= 0");
+        return 0;
+    }
+    if (set.fan_readback < 1) {
+        log_log(LOG_L_DEBUG, "%s", "Value of fan_readback must be >= 1");
+        return 0;
+    }
+    if (set.fan_slew < 0) {
+        log_log(LOG_L_DEBUG, "%s", "Value of fan_slew must be >= 0");
+        return 0;
+    }
+    if (set.fan_backend < FAN_B_AUTO || set.fan_backend > FAN_B_PWM) {
+        log_log(LOG_L_DEBUG, "%s", "Value of fan_backend must be one of auto, applesmc and pwm");
+        return 0;
+    }
+    if (!set.sysfs_root) {
+        if (!set_set_str(SET_SYSFS_ROOT, "/sys")) {
+            log_log(LOG_L_DEBUG, "%s", "Unable to set default sysfs root to /sys");
+            return 0;
+        }
+    }
+    if (!set.pwm_chips) {
+        if (!set_set_str(SET_PWM_CHIPS, "nct67,it87")) {
+            log_log(LOG_L_DEBUG, "%s", "Unable to set default pwm chips to nct67,it87");
+            return 0;
+        }
+    }
+    if (set.pwm_min < 0 || set.pwm_min > 99) {
+        log_log(LOG_L_DEBUG, "%s", "Value of pwm_min must be >= 0 and <= 99");
+        return 0;
+    }
+    if (set.fan_settle < 0) {
+        log_log(LOG_L_DEBUG, "%s", "Value of fan_settle_ms must be >= 0");
+        return 0;
+    }
+    if (set.fan_tolerance < 1 || set.fan_tolerance > 99) {
+        log_log(LOG_L_DEBUG, "%s", "Value of fan_tolerance must be >= 1 and <= 99");
+        return 0;
+    }
+    if (!set.status_file_path) {
+        if (!set_set_str(SET_STATUS_FILE_PATH, "/tmp/macfand.status")) {
+            log_log(LOG_L_DEBUG, "%s", "Unable to set default status file path to /tmp/macfand.status");
+            return 0;
+        }
+    }
 
     return 1;
 }
 
 
 int set_get_int(int choice) {
-    switch (choice) {
-        case SET_TEMP_LOW:
-            return set.temp_low;
-        case SET_TEMP_HIGH:
-            return set.temp_high;
-        case SET_TEMP_MAX:
-            return set.temp_max;
-        case SET_TIME_POLL:
-            return set.time_poll;
-        case SET_DAEMON:
-            return set.daemon;
-        case SET_VERBOSE:
-            return set.verbose;
-        case SET_LOG_TYPE:
-            return set.log_type;
-        case SET_WIDGET:
-            return set.widget;
-        default:
-            return -1;
-    }
+    if (!set_desc_ok(choice, SET_T_INT))
+        return -1;
+
+    return *SET_PTR(&set, choice, int);
+}
+
+
+double set_get_dbl(int choice) {
+    if (!set_desc_ok(choice, SET_T_DBL))
+        return -1;
+
+    return *SET_PTR(&set, choice, double);
 }
 
 
 char* set_get_str(int choice) {
-    switch (choice) {
-        case SET_LOG_FILE_PATH:
-            return set.log_file_path;
-        case SET_WIDGET_FILE_PATH:
-            return set.widget_file_path;
-        case SET_CONFIG_FILE_PATH:
-            return set.config_file_path;
-        default:
-            return NULL;
-    }
+    if (!set_desc_ok(choice, SET_T_STR))
+        return NULL;
+
+    return *SET_PTR(&set, choice, char*);
 }
 
 
 int set_set_int(int choice, int val) {
+    if (!set_desc_ok(choice, SET_T_INT))
+        return 0;
 
-    switch (choice) {
-        case SET_TEMP_LOW:
-            set.temp_low = val;
-            break;
-        case SET_TEMP_HIGH:
-            set.temp_high = val;
-            break;
-        case SET_TEMP_MAX:
-            set.temp_max = val;
-            break;
-        case SET_TIME_POLL:
-            set.time_poll = val;
-            break;
-        case SET_DAEMON:
-            set.daemon = val;
-            break;
-        case SET_VERBOSE:
-            set.verbose = val;
-            break;
-        case SET_LOG_TYPE:
-            set.log_type = val;
-            break;
-        case SET_WIDGET:
-            set.widget = val;
-            break;
-        default:
-            return 0;
-    }
+    *SET_PTR(&set, choice, int) = val;
+    return 1;
+}
+
+
+int set_set_str(int choice, const char *const val) {
+    char *cpy = NULL;
+
+    if (!val || !set_desc_ok(choice, SET_T_STR))
+        return 0;
+
+    cpy = (char*)malloc(strlen(val)+1);
+    if (!cpy)
+        return 0;
+    strcpy(cpy, val);
+
+    // Old value is kept when copy fails
+    free(*SET_PTR(&set, choice, char*));
+    *SET_PTR(&set, choice, char*) = cpy;
+    return 1;
+}
+
+
+int set_set_dbl(int choice, double val) {
+    if (!set_desc_ok(choice, SET_T_DBL))
+        return 0;
+
+    *SET_PTR(&set, choice, double) = val;
+    return 1;
+}
+
+
+int set_base_save(void) {
+    if (base.ok)
+        set_vals_free(&(base.vals));
+
+    base.ok = set_vals_copy(&(base.vals), &set);
+    return base.ok;
+}
+
+
+int set_reset(void) {
+    struct set_vals vals;
 
+    if (!base.ok || !set_vals_copy(&vals, &(base.vals)))
+        return 0;
+
+    // Derived from monitors, not from configuration file
+    vals.temp_max = set.temp_max;
+
+    set_vals_free(&set);
+    set = vals;
     return 1;
 }
 
 
-int set_set_str(int choice, const char *const val) { 
-    if (!val)
+int set_snap_save(void) {
+    set_snap_free();
+
+    snap.ok = set_vals_copy(&(snap.vals), &set);
+    return snap.ok;
+}
+
+
+void set_snap_restore(void) {
+    if (!snap.ok)
+        return;
+
+    // Snapshot strings are moved, not copied
+    set_vals_free(&set);
+    set = snap.vals;
+    snap.ok = 0;
+}
+
+
+void set_snap_free(void) {
+    if (!snap.ok)
+        return;
+
+    set_vals_free(&(snap.vals));
+    snap.ok = 0;
+}
+
+
+int set_snap_keep(int choice) {
+    const char *old = NULL;
+    char       *cpy = NULL;
+
+    if (!snap.ok || choice < 0 || choice >= SET_CNT)
         return 0;
 
-    switch (choice) {
+    switch (set_descs[choice].type) {
+        case SET_T_INT:
+            *SET_PTR(&set, choice, int) = *SET_PTR(&(snap.vals), choice, int);
+            return 1;
+        case SET_T_DBL:
+            *SET_PTR(&set, choice, double) = *SET_PTR(&(snap.vals), choice, double);
+            return 1;
+        default:
+            old = *SET_PTR(&(snap.vals), choice, char*);
+            if (old) {
+                cpy = (char*)malloc(strlen(old)+1);
+                if (!cpy)
+                    return 0;
+                strcpy(cpy, old);
+            }
+            free(*SET_PTR(&set, choice, char*));
+            *SET_PTR(&set, choice, char*) = cpy;
+            return 1;
+    }
+}
 
-        case SET_LOG_FILE_PATH:
-            if (set.log_file_path)
-                free(set.log_file_path);
-            set.log_file_path = (char*)malloc(strlen(val)+1);
-            if (!set.log_file_path)
-                return 0;
-            strcpy(set.log_file_path, val);
-            break;
 
-        case SET_WIDGET_FILE_PATH:
-            if (set.widget_file_path)
-                free(set.widget_file_path);
-            set.widget_file_path = (char*)malloc(strlen(val)+1);
-            if (!set.widget_file_path)
-                return 0;
-            strcpy(set.widget_file_path, val);
-            break;
+int set_snap_changed(int choice) {
+    const char *old = NULL;
+    const char *cur = NULL;
 
-        case SET_CONFIG_FILE_PATH:
-            if (set.config_file_path)
-                free(set.config_file_path);
-            set.config_file_path = (char*)malloc(strlen(val)+1);
-            if (!set.config_file_path)
-                return 0;
-            strcpy(set.config_file_path, val);
-            break;
+    if (!snap.ok || choice < 0 || choice >= SET_CNT)
+        return 0;
 
+    switch (set_descs[choice].type) {
+        case SET_T_INT:
+            return *SET_PTR(&(snap.vals), choice, int) != *SET_PTR(&set, choice, int);
+        case SET_T_DBL:
+            return *SET_PTR(&(snap.vals), choice, double) != *SET_PTR(&set, choice, double);
         default:
-            return 0;
+            old = *SET_PTR(&(snap.vals), choice, char*);
+            cur = *SET_PTR(&set, choice, char*);
+            if (!old || !cur)
+                return old != cur;
+            return strcmp(old, cur) != 0;
     }
+}
 
-    return 1;
-}
\ No newline at end of file
+
+int set_snap_log(void) {
+    const char *old = NULL;
+    const char *cur = NULL;
+    int        cnt  = 0;
+    int        i    = 0;
+
+    for (i = 0; i < SET_CNT; i++) {
+        if (!set_snap_changed(i))
+            continue;
+        cnt++;
+
+        switch (set_descs[i].type) {
+            case SET_T_INT:
+                log_log(LOG_L_INFO, "Setting %s changed from %d to %d", set_descs[i].name,
+                        *SET_PTR(&(snap.vals), i, int), *SET_PTR(&set, i, int));
+                break;
+            case SET_T_DBL:
+                log_log(LOG_L_INFO, "Setting %s changed from %g to %g", set_descs[i].name,
+                        *SET_PTR(&(snap.vals), i, double), *SET_PTR(&set, i, double));
+                break;
+            default:
+                old = *SET_PTR(&(snap.vals), i, char*);
+                cur = *SET_PTR(&set, i, char*);
+                log_log(LOG_L_INFO, "Setting %s changed from \"%s\" to \"%s\"", set_descs[i].name,
+                        (old) ? old : "", (cur) ? cur : "");
+                break;
+        }
+    }
+
+    return cnt;
+}
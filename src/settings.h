@@ -15,7 +15,8 @@
 /**
  * @brief Enum holding all available settings.
  * Enum holding all available settings, which are temperatures low, high and max. 
- * Poll time of fan adjust and daemon and verbose modes.
+ * Poll time of fan adjust (and its idle limit) in milliseconds, daemon and verbose modes, use of io_uring for reading, selected sensor sources, status file, thermal zones, fan curves,
+ * control mode, PID controller target and gains and model-predictive controller ceiling and horizon.
  */
 enum setting {
     SET_TEMP_LOW,
@@ -28,7 +29,38 @@ enum setting {
     SET_LOG_FILE_PATH,
     SET_WIDGET,
     SET_WIDGET_FILE_PATH,
-    SET_CONFIG_FILE_PATH
+    SET_CONFIG_FILE_PATH,
+    SET_IO_URING,
+    SET_SENSORS,
+    SET_STATUS_FILE_PATH,
+    SET_ZONES,
+    SET_CURVE,
+    SET_CURVE_FALL,
+    SET_CTRL_MODE,
+    SET_PID_TARGET,
+    SET_PID_KP,
+    SET_PID_KI,
+    SET_PID_KD,
+    SET_PID_TAU,
+    SET_MPC_CEILING,
+    SET_MPC_HORIZON,
+    SET_TIME_POLL_IDLE,
+    SET_FEED_POWER_LOW,
+    SET_FEED_POWER_HIGH,
+    SET_FEED_LOAD_LOW,
+    SET_FEED_LOAD_HIGH,
+    SET_PSI_STALL,
+    SET_PSI_WINDOW,
+    SET_FAN_DEADBAND,
+    SET_FAN_DWELL,
+    SET_FAN_READBACK,
+    SET_FAN_SLEW,
+    SET_FAN_BACKEND,
+    SET_SYSFS_ROOT,
+    SET_PWM_CHIPS,
+    SET_PWM_MIN,
+    SET_FAN_SETTLE,
+    SET_FAN_TOLERANCE
 };
 
 /**
@@ -61,6 +93,14 @@ int set_get_int(int choice);
  */
 char* set_get_str(int choice);
 
+/**
+ * @brief Gets setting double value.
+ * Gets double value of given setting.
+ * @param[in]  setting  Setting which value we want to get (one of enum setting).
+ * @return double -1 on error, value of given settings otherwise.
+ */
+double set_get_dbl(int choice);
+
 /**
  * @brief Sets setting integer value.
  * Sets integer value of given setting to value. Does not check validity of given setting.
@@ -80,4 +120,73 @@ int set_set_int(int choice, int val);
  */
 int set_set_str(int choice, const char *const val);
 
+/**
+ * @brief Sets setting double value.
+ * Sets double value of given setting to value. Does not check validity of given setting.
+ * @param[in]  setting  Setting which value we want to set (one of enum setting).
+ * @param[in]  value    Value to be set.
+ * @return int 0 on error, 1 on success.
+ */
+int set_set_dbl(int choice, double val);
+
+/**
+ * @brief Saves base of settings.
+ * Saves copy of all current settings (defaults with command line overrides) as base on which configuration file
+ * is loaded again by set_reset() and conf_load(). Previous base is freed.
+ * @return int 0 on error, 1 on success.
+ */
+int set_base_save(void);
+
+/**
+ * @brief Resets settings to base.
+ * Replaces all current settings by base saved by set_base_save(), so settings removed from configuration file
+ * return to their defaults. Max temperature derived from monitors keeps its current value.
+ * @return int 0 on error (current settings are kept then), 1 on success.
+ */
+int set_reset(void);
+
+/**
+ * @brief Saves snapshot of settings.
+ * Saves copy of all current settings, so they can be compared with or restored after reload of configuration
+ * file. Previous snapshot is freed.
+ * @return int 0 on error, 1 on success.
+ */
+int set_snap_save(void);
+
+/**
+ * @brief Restores settings from snapshot.
+ * Replaces all current settings by settings saved by last set_snap_save() and frees snapshot.
+ */
+void set_snap_restore(void);
+
+/**
+ * @brief Frees snapshot of settings.
+ * Frees memory used by snapshot of settings.
+ */
+void set_snap_free(void);
+
+/**
+ * @brief Keeps previous value of setting.
+ * Replaces current value of given setting by its value in snapshot saved by last set_snap_save(). Used for settings
+ * which cannot be changed while running.
+ * @param[in]  setting  Setting which value we want to keep (one of enum setting).
+ * @return int 0 on error (or there is no snapshot), 1 on success.
+ */
+int set_snap_keep(int choice);
+
+/**
+ * @brief Checks whether setting changed.
+ * Checks whether given setting differs from its value in snapshot saved by last set_snap_save().
+ * @param[in]  setting  Setting which we want to check (one of enum setting).
+ * @return int 0 if setting did not change (or there is no snapshot), 1 otherwise.
+ */
+int set_snap_changed(int choice);
+
+/**
+ * @brief Logs changed settings.
+ * Logs name, previous and current value of every setting which differs from snapshot saved by last set_snap_save().
+ * @return int number of changed settings.
+ */
+int set_snap_log(void);
+
 #endif //MACFAND_SETTINGS_H_jkdhfasjkf
\ No newline at end of file
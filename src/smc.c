@@ -0,0 +1,284 @@
+/**
+ * macfand - hipuranyhou - 16.10.2026
+ *
+ * Daemon for controlling fans on Linux systems using
+ * applesmc and coretemp.
+ *
+ * https://github.com/Hipuranyhou/macfand
+ */
+
+#include <dirent.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+
+#include "smc.h"
+#include "helper.h"
+#include "logger.h"
+#include "settings.h"
+
+#define SMC_PATH_DEV "/devices/platform/applesmc.768"
+#define SMC_PATH_RD  "input"
+#define SMC_PATH_WR  "output"
+#define SMC_PATH_MAX "max"
+#define SMC_PATH_MIN "min"
+#define SMC_PATH_MOD "manual"
+#define SMC_PATH_LBL "label"
+#define SMC_PATH_FMT "%s" SMC_PATH_DEV "/fan%d_%s"
+
+/**
+ * @brief Loads label of fan.
+ * Loads label of given fan by reading the appropriate system file.
+ * @param[in,out] fan Pointer to fan.
+ * @return int 0 on error, 1 on success.
+ */
+static int smc_load_lbl(t_fan *const fan);
+
+/**
+ * @brief Loads given speed limit of fan.
+ * Loads min or max speed of given fan by reading the appropriate system file.
+ * @param[in,out] fan  Pointer to fan which speed limit should be read.
+ * @param[in]     suff Path end of wanted speed (one of SMC_PATH_MAX and SMC_PATH_MIN).
+ * @return int 0 on error, 1 on success.
+ */
+static int smc_load_spd(t_fan *const fan, const char *const suff);
+
+/**
+ * @brief Loads default values for given fan.
+ * Constructs reading, writing, mode setting and speed limit paths of given fan, loads its max and min speed
+ * and label and finishes it using fan_load().
+ * @param[in,out] fan Pointer to fan to be loaded.
+ * @return int 0 on error, 1 on success.
+ */
+static int smc_load_def(t_fan *const fan);
+
+/**
+ * @brief Filters out files not starting filename with "fan".
+ * Filters out files not starting filename with "fan" when using scandir().
+ * @param[in] dirent Pointer to dirent entry which filename we check.
+ * @return int 0 on not starting, 1 on starting.
+ */
+static int smc_load_filter(const struct dirent *dirent);
+
+/**
+ * @brief Discovers applesmc fans.
+ * Constructs generic linked list of all fans of applesmc.
+ * @return t_node* NULL if applesmc has no fans (or on error), pointer to head of generic linked list of
+ * system fans otherwise.
+ */
+static t_node *smc_load(void);
+
+/**
+ * @brief Sets mode of applesmc fan.
+ * Sets given fan to manual or automatic mode.
+ * @param[in,out] fan Pointer to fan.
+ * @param[in]     mod Mode to which should fan be set.
+ * @return int 0 on error, 1 on success.
+ */
+static int smc_write_mod(t_fan *const fan, const enum fan_mode mod);
+
+/**
+ * @brief Sets speed of applesmc fan.
+ * Writes given target speed (in RPM) of given fan.
+ * @param[in,out] fan Pointer to fan.
+ * @param[in]     spd Speed in RPM.
+ * @return int 0 on error, 1 on success.
+ */
+static int smc_write_spd(t_fan *const fan, const int spd);
+
+
+const struct fan_bknd smc_bknd = {
+    .name = "applesmc",
+    .unit = "RPM",
+    .rpm = 1,
+    .load = smc_load,
+    .write_mod = smc_write_mod,
+    .write_spd = smc_write_spd
+};
+
+
+static int smc_load_lbl(t_fan *const fan) {
+    char    *path    = NULL;
+    FILE    *file    = NULL;
+    ssize_t get_ret  = 0;
+    size_t  lbl_size = 0;
+
+    if (!fan)
+        return 0;
+
+    fan->lbl = NULL;
+
+    path = concat_fmt(SMC_PATH_FMT, set_get_str(SET_SYSFS_ROOT), fan->id, SMC_PATH_LBL);
+    if (!path)
+        return 0;
+
+    file = fopen(path, "r");
+    free(path);
+    if (!file) {
+        log_log(LOG_L_DEBUG, "Unable to open label file of fan %d", fan->id);
+        return 0;
+    }
+
+    errno = 0;
+    get_ret = getline(&(fan->lbl), &lbl_size, file);
+    if (get_ret < 2 || errno != 0) {
+        log_log(LOG_L_DEBUG, "Unable to load label of fan %d", fan->id);
+        if (fclose(file) == EOF)
+            log_log(LOG_L_DEBUG, "Unable to close label file of fan %d", fan->id);
+        return 0;
+    }
+
+    // (get_ret - 2) because line ends with "'0x10''0x0A'"
+    fan->lbl[get_ret-2] = '\0';
+
+    if (fclose(file) == EOF)
+        log_log(LOG_L_DEBUG, "Unable to close label file of fan %d", fan->id);
+    return 1;
+}
+
+
+static int smc_load_spd(t_fan *const fan, const char *const suff) {
+    t_hnd hnd;
+    int   *dest = NULL;
+    char  *path = NULL;
+    int   ret   = 0;
+
+    if (!fan || !suff)
+        return 0;
+
+    if (strcmp(SMC_PATH_MIN, suff) == 0) {
+        dest = &(fan->spd.min);
+        path = fan->path.min;
+    } else if (strcmp(SMC_PATH_MAX, suff) == 0) {
+        dest = &(fan->spd.max);
+        path = fan->path.max;
+    } else
+        return 0;
+
+    if (!hnd_open(&hnd, path, O_RDONLY)) {
+        log_log(LOG_L_DEBUG, "Unable to open speed file of fan %d", fan->id);
+        return 0;
+    }
+
+    ret = hnd_read_int(&hnd, dest);
+    if (!ret)
+        log_log(LOG_L_DEBUG, "Invalid speed of fan %d", fan->id);
+
+    hnd_close(&hnd);
+    return ret;
+}
+
+
+static int smc_load_def(t_fan *const fan) {
+    const char *root = set_get_str(SET_SYSFS_ROOT);
+
+    if (!fan)
+        return 0;
+
+    fan->bknd = &smc_bknd;
+    fan->mod = FAN_M_AUTO;
+
+    // Load all paths of given fan
+    fan->path.rd = concat_fmt(SMC_PATH_FMT, root, fan->id, SMC_PATH_RD);
+    fan->path.wr = concat_fmt(SMC_PATH_FMT, root, fan->id, SMC_PATH_WR);
+    fan->path.mod = concat_fmt(SMC_PATH_FMT, root, fan->id, SMC_PATH_MOD);
+    fan->path.min = concat_fmt(SMC_PATH_FMT, root, fan->id, SMC_PATH_MIN);
+    fan->path.max = concat_fmt(SMC_PATH_FMT, root, fan->id, SMC_PATH_MAX);
+    fan->path.dev = concat_fmt("%s", SMC_PATH_DEV);
+    if (!fan->path.rd || !fan->path.wr || !fan->path.mod || !fan->path.min || !fan->path.max || !fan->path.dev) {
+        log_log(LOG_L_DEBUG, "Unable to load read, write or mode path of fan %d", fan->id);
+        return 0;
+    }
+
+    // Load min and max speed of given fan
+    if (!smc_load_spd(fan, SMC_PATH_MIN) || !smc_load_spd(fan, SMC_PATH_MAX)) {
+        log_log(LOG_L_DEBUG, "Unable to load max or min speed of fan %d", fan->id);
+        return 0;
+    }
+
+    // Load fan label
+    if (!smc_load_lbl(fan)) {
+        log_log(LOG_L_DEBUG, "Unable to load label of fan %d", fan->id);
+        return 0;
+    }
+
+    return fan_load(fan);
+}
+
+
+static int smc_load_filter(const struct dirent *dirent) {
+    return (strncmp(dirent->d_name, "fan", 3) == 0);
+}
+
+
+static t_node *smc_load(void) {
+    struct dirent **names    = NULL;
+    int           names_size = 0;
+    char          inv        = 0;
+    int           id_prev    = 0;
+    int           to_int_ret = 0;
+    char          *dir       = NULL;
+    t_fan         fan;
+    t_node        *fans      = NULL;
+
+    dir = concat_fmt("%s%s", set_get_str(SET_SYSFS_ROOT), SMC_PATH_DEV);
+    if (!dir)
+        return NULL;
+
+    errno = 0;
+    names_size = scandir(dir, &names, smc_load_filter, alphasort);
+    free(dir);
+    if (names_size < 0) {
+        log_log(LOG_L_DEBUG, "Unable to open applesmc fans directory.");
+        return NULL;
+    }
+
+    // Walk through fans directory
+    while (names_size--) {
+        // Previous fan is now owned by list
+        fan_clear(&fan);
+
+        // Get id of fan
+        to_int_ret = str_to_int(names[names_size]->d_name+3, &(fan.id), 10, &inv);
+        if (to_int_ret < 0 || inv != '_') {
+            list_free(fans, (void (*)(void *, int))fan_free);
+            fan_free(&fan, 0);
+            free_dirent_names(names, names_size);
+            log_log(LOG_L_DEBUG, "Invalid fan filename encountered.");
+            return NULL;
+        }
+
+        // Skip already finished fan
+        if (fan.id == id_prev) {
+            free(names[names_size]);
+            continue;
+        }
+        id_prev = fan.id;
+
+        // Load fan defaults and append it to linked list of fans
+        if (!smc_load_def(&fan) || !list_push_front(&fans, &fan, sizeof(fan))) {
+            list_free(fans, (void (*)(void *, int))fan_free);
+            fan_free(&fan, 0);
+            free_dirent_names(names, names_size);
+            log_log(LOG_L_DEBUG, "Unable to load defaults of fan %d", fan.id);
+            return NULL;
+        }
+
+        free(names[names_size]);
+    }
+
+    if (names)
+        free(names);
+    return fans;
+}
+
+
+static int smc_write_mod(t_fan *const fan, const enum fan_mode mod) {
+    return hnd_write_int(&(fan->hnd.mod), mod);
+}
+
+
+static int smc_write_spd(t_fan *const fan, const int spd) {
+    return hnd_write_int(&(fan->hnd.wr), spd);
+}
@@ -0,0 +1,22 @@
+/**
+ * macfand - hipuranyhou - 16.10.2026
+ *
+ * Daemon for controlling fans on Linux systems using
+ * applesmc and coretemp.
+ *
+ * https://github.com/Hipuranyhou/macfand
+ */
+
+#ifndef MACFAND_SMC_H_gkqpzmwuey
+#define MACFAND_SMC_H_gkqpzmwuey
+
+#include "fan.h"
+
+/**
+ * @brief Applesmc fan backend.
+ * Fan backend driving fans of applesmc platform device, which takes target speed of fan in RPM and switches
+ * fan between automatic and manual mode.
+ */
+extern const struct fan_bknd smc_bknd;
+
+#endif //MACFAND_SMC_H_gkqpzmwuey
@@ -0,0 +1,70 @@
+/**
+ * macfand - hipuranyhou - 16.10.2026
+ *
+ * Daemon for controlling fans on Linux systems using
+ * applesmc and coretemp.
+ *
+ * https://github.com/Hipuranyhou/macfand
+ */
+
+#include <stdio.h>
+
+#include "status.h"
+#include "settings.h"
+#include "logger.h"
+#include "fan.h"
+#include "helper.h"
+#include "sweep.h"
+
+
+void stat_write(const t_mons *const mons, const t_zones *const zones, const t_node *fans, const t_tmr *const tmr,
+                const t_pwr *const pwr) {
+    FILE      *file = NULL;
+    t_fan     *fan  = NULL;
+    long long now   = time_mono_us();
+
+    file = fopen(set_get_str(SET_STATUS_FILE_PATH), "w");
+    if (!file) {
+        log_log(LOG_L_ERROR, "%s", "Unable to open status file");
+        return;
+    }
+
+    fprintf(file, "##### THROTTLING #####\n");
+    mons_print_thr(mons, now, file);
+
+    fprintf(file, "\n##### MONITORS #####\n");
+    mons_print_excl(mons, file);
+
+    fprintf(file, "\n##### ZONES #####\n");
+    zones_print(zones, file);
+
+    fprintf(file, "\n##### FANS #####\n");
+    while (fans) {
+        fan = fans->data;
+        fprintf(file, "Fan %d: %d RPM (target %d %s, commanded %d %s)\n", fan->id, fan->spd.real, fan->spd.tgt,
+                fan->bknd->unit, fan->cmd.spd, fan->bknd->unit);
+        fprintf(file, "Speed writes: %lld (%.1f per hour)\n", fan->cmd.writes, fan_get_writes(fan, now));
+        // Error is known only when commanded speed is RPM as well
+        if (fan->bknd->rpm)
+            fprintf(file, "Tracking: %s (error %+d RPM, %lld faults)\n", fan_get_state(fan), fan->trk.err,
+                    fan->trk.faults);
+        else
+            fprintf(file, "Tracking: %s (%lld faults)\n", fan_get_state(fan), fan->trk.faults);
+        fans = fans->next;
+    }
+
+    fprintf(file, "\n##### FEED-FORWARD #####\n");
+    pwr_print(pwr, file);
+
+    fprintf(file, "\n##### TIMING #####\n");
+    tmr_print(tmr, file);
+    swp_print(file);
+
+    if (ferror(file))
+        log_log(LOG_L_ERROR, "%s", "Unable to write status file");
+
+    if (fclose(file) == EOF)
+        log_log(LOG_L_ERROR, "%s", "Unable to close status file");
+    else
+        log_log(LOG_L_INFO, "Status written to %s", set_get_str(SET_STATUS_FILE_PATH));
+}
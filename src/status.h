@@ -0,0 +1,32 @@
+/**
+ * macfand - hipuranyhou - 16.10.2026
+ *
+ * Daemon for controlling fans on Linux systems using
+ * applesmc and coretemp.
+ *
+ * https://github.com/Hipuranyhou/macfand
+ */
+
+#ifndef MACFAND_STATUS_H_qpwoeirutz
+#define MACFAND_STATUS_H_qpwoeirutz
+
+#include "linked.h"
+#include "monitor.h"
+#include "zone.h"
+#include "timer.h"
+#include "power.h"
+
+/**
+ * @brief Writes status file.
+ * Writes current status of macfand (monitors excluded from control, thermal zones, ...) to status file.
+ * Called from main control loop when SIGUSR1 is catched.
+ * @param[in] mons  Pointer to table of temperature monitors.
+ * @param[in] zones Pointer to table of thermal zones.
+ * @param[in] fans  Pointer to head of generic linked list of system fans.
+ * @param[in] tmr   Pointer to control loop timer.
+ * @param[in] pwr   Pointer to feed-forward inputs.
+ */
+void stat_write(const t_mons *const mons, const t_zones *const zones, const t_node *fans, const t_tmr *const tmr,
+                const t_pwr *const pwr);
+
+#endif //MACFAND_STATUS_H_qpwoeirutz
@@ -0,0 +1,353 @@
+/**
+ * macfand - hipuranyhou - 16.10.2026
+ *
+ * Daemon for controlling fans on Linux systems using
+ * applesmc and coretemp.
+ *
+ * https://github.com/Hipuranyhou/macfand
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#ifdef HAVE_LIBURING
+#include <liburing.h>
+#endif
+
+#include "sweep.h"
+#include "handle.h"
+#include "monitor.h"
+#include "fan.h"
+#include "logger.h"
+#include "settings.h"
+#include "helper.h"
+
+/**
+ * @brief Struct holding sweep timing statistics.
+ * Struct holding number of sweeps, wall time of last sweep, sum and max of wall times of all sweeps
+ * (in microseconds).
+ */
+static struct {
+    long long cnt;
+    long long last;
+    long long sum;
+    long long max;
+} swp_stat = {
+    .cnt = 0,
+    .last = 0,
+    .sum = 0,
+    .max = 0
+};
+
+#ifdef HAVE_LIBURING
+
+/**
+ * @brief Struct holding one queued read.
+ * Struct holding table and index of monitor or fan (the other one is NULL) which is read by this
+ * entry, whether its read was already finished and buffer into which is its attribute read.
+ */
+struct swp_ent {
+    t_mons *mons;
+    int    mon;
+    t_fan  *fan;
+    int    done;
+    char   buf[HND_BUF_SIZE];
+};
+
+/**
+ * @brief Struct holding io_uring backend state.
+ * Struct holding whether io_uring is used, number of prepared entries and the ring itself.
+ */
+static struct {
+    int             on;
+    unsigned        size;
+    struct swp_ent  *ents;
+    struct io_uring ring;
+} swp = {
+    .on = 0,
+    .size = 0,
+    .ents = NULL
+};
+
+/**
+ * @brief Queues read of given handle.
+ * Queues read of given handle into buffer of given entry. Closed handle is reopened synchronously first.
+ * @param[in]     hnd Handle to be read.
+ * @param[in,out] ent Entry into which is handle read.
+ * @return int 0 on error, 1 on success.
+ */
+static int swp_uring_queue(t_hnd *const hnd, struct swp_ent *const ent);
+
+/**
+ * @brief Finishes one completed read.
+ * Parses value read by given entry into its monitor or fan. Monitor read is finished by mons_read_done(),
+ * failed fan is read again synchronously using fan_read_spd(), which recovers its handles.
+ * @param[in,out] ent Completed entry.
+ * @param[in]     res Result of read (number of read bytes or negative errno).
+ */
+static void swp_uring_done(struct swp_ent *const ent, const int res);
+
+/**
+ * @brief Finishes unfinished reads synchronously.
+ * Reads monitor or fan of every one of given number of queued entries, which was not finished by
+ * swp_uring_done(), one after another and frees io_uring backend. Used when io_uring fails in the middle
+ * of sweep, so no monitor is finished twice.
+ * @param[in] cnt Number of queued entries.
+ */
+static void swp_uring_fail(const unsigned cnt);
+
+/**
+ * @brief Reads all monitors and fans using io_uring.
+ * Queues read of every monitor and fan, submits them at once and reaps all completions.
+ * @param[in,out] mons Pointer to table of temperature monitors.
+ * @param[in,out] fans Pointer to head of generic linked list of system fans.
+ * @return int 0 if synchronous read is needed (nothing was read), 1 on success.
+ */
+static int swp_uring_read(t_mons *const mons, t_node *fans);
+
+
+static int swp_uring_queue(t_hnd *const hnd, struct swp_ent *const ent) {
+    struct io_uring_sqe *sqe = NULL;
+
+    if (hnd->fd < 0 && !hnd_reopen(hnd))
+        return 0;
+
+    sqe = io_uring_get_sqe(&(swp.ring));
+    if (!sqe)
+        return 0;
+
+    // sysfs regenerates attribute content on every read from offset 0
+    io_uring_prep_read(sqe, hnd->fd, ent->buf, sizeof(ent->buf), 0);
+    io_uring_sqe_set_data(sqe, ent);
+    return 1;
+}
+
+
+static void swp_uring_done(struct swp_ent *const ent, const int res) {
+    ent->done = 1;
+
+    if (ent->mons) {
+        mons_read_done(ent->mons, ent->mon, hnd_parse_int(ent->buf, res, &(ent->mons->temp[ent->mon])));
+        return;
+    }
+
+    if (hnd_parse_int(ent->buf, res, &(ent->fan->spd.real)))
+        return;
+
+    hnd_close(&(ent->fan->hnd.rd));
+    if (!fan_read_spd(ent->fan))
+        log_log(LOG_L_DEBUG, "Unable to read speed of fan %d", ent->fan->id);
+}
+
+
+static void swp_uring_fail(const unsigned cnt) {
+    struct swp_ent *ent = NULL;
+    unsigned       i    = 0;
+
+    for (i = 0; i < cnt; i++) {
+        ent = &(swp.ents[i]);
+        if (ent->done)
+            continue;
+        if (ent->mons)
+            mons_read_done(ent->mons, ent->mon, hnd_read_int(&(ent->mons->hnd[ent->mon]),
+                           &(ent->mons->temp[ent->mon])));
+        else if (!fan_read_spd(ent->fan))
+            log_log(LOG_L_DEBUG, "Unable to read speed of fan %d", ent->fan->id);
+    }
+
+    swp_exit();
+}
+
+
+static int swp_uring_read(t_mons *const mons, t_node *fans) {
+    struct io_uring_cqe *cqe     = NULL;
+    struct swp_ent      *ent     = NULL;
+    t_node              *head    = NULL;
+    unsigned            cnt      = mons->cnt;
+    int                 sub      = 0;
+    int                 left     = 0;
+    int                 wait_ret = 0;
+    int                 i        = 0;
+
+    // Lists grew since ring was prepared
+    for (head = fans; head; head = head->next)
+        cnt++;
+    if (cnt > swp.size)
+        return 0;
+    cnt = 0;
+
+    // Queue all monitors
+    for (i = 0; i < mons->cnt; i++) {
+        if (mons_read_skip(mons, i))
+            continue;
+        ent = &(swp.ents[cnt]);
+        ent->mons = mons;
+        ent->mon = i;
+        ent->fan = NULL;
+        ent->done = 0;
+        if (!swp_uring_queue(&(mons->hnd[i]), ent)) {
+            mons_read_done(mons, i, 0);
+            continue;
+        }
+        cnt++;
+    }
+
+    // Queue all fans
+    for (; fans; fans = fans->next) {
+        ent = &(swp.ents[cnt]);
+        ent->mons = NULL;
+        ent->fan = fans->data;
+        ent->done = 0;
+        if (!swp_uring_queue(&(ent->fan->hnd.rd), ent)) {
+            if (!fan_read_spd(ent->fan))
+                log_log(LOG_L_DEBUG, "Unable to read speed of fan %d", ent->fan->id);
+            continue;
+        }
+        cnt++;
+    }
+
+    if (cnt == 0)
+        return 1;
+
+    // Submit everything at once
+    do {
+        sub = io_uring_submit(&(swp.ring));
+    } while (sub == -EINTR);
+
+    if (sub < 0) {
+        log_log(LOG_L_WARN, "Unable to submit io_uring sweep (%s), falling back to synchronous reads", strerror(-sub));
+        swp_uring_fail(cnt);
+        return 1;
+    }
+
+    // Reap all completions
+    left = sub;
+    while (left) {
+        wait_ret = io_uring_wait_cqe(&(swp.ring), &cqe);
+        if (wait_ret == -EINTR)
+            continue;
+        if (wait_ret < 0) {
+            log_log(LOG_L_WARN, "Unable to reap io_uring sweep (%s), falling back to synchronous reads", strerror(-wait_ret));
+            swp_uring_fail(cnt);
+            return 1;
+        }
+
+        swp_uring_done(io_uring_cqe_get_data(cqe), cqe->res);
+        io_uring_cqe_seen(&(swp.ring), cqe);
+        left--;
+    }
+
+    // Some reads were left in submission queue, ring is in unknown state
+    if ((unsigned)sub != cnt) {
+        log_log(LOG_L_WARN, "io_uring sweep was submitted only partially, falling back to synchronous reads");
+        swp_uring_fail(cnt);
+        return 1;
+    }
+
+    return 1;
+}
+
+#endif //HAVE_LIBURING
+
+
+int swp_init(const t_mons *const mons, const t_node *fans) {
+#ifdef HAVE_LIBURING
+    unsigned size     = mons->cnt;
+    int      init_ret = 0;
+
+    swp_exit();
+
+    if (!set_get_int(SET_IO_URING))
+        return 1;
+
+    for (; fans; fans = fans->next)
+        size++;
+    if (size == 0)
+        return 0;
+
+    swp.ents = (struct swp_ent*)malloc(size * sizeof(*(swp.ents)));
+    if (!swp.ents)
+        return 0;
+
+    init_ret = io_uring_queue_init(size, &(swp.ring), 0);
+    if (init_ret < 0) {
+        log_log(LOG_L_WARN, "io_uring is not available (%s), using synchronous sweep", strerror(-init_ret));
+        free(swp.ents);
+        swp.ents = NULL;
+        return 1;
+    }
+
+    swp.size = size;
+    swp.on = 1;
+#else
+    (void)mons;
+    (void)fans;
+
+    if (set_get_int(SET_IO_URING))
+        log_log(LOG_L_WARN, "macfand was built without liburing, using synchronous sweep");
+#endif
+
+    log_log(LOG_L_INFO, "Using %s sweep backend", swp_name());
+    return 1;
+}
+
+
+void swp_read(t_mons *const mons, t_node *fans) {
+    long long start = time_mono_us();
+
+#ifdef HAVE_LIBURING
+    if (!swp.on || !swp_uring_read(mons, fans)) {
+#endif
+        mons_read_temp(mons);
+        if (!fans_read_spd(fans))
+            log_log(LOG_L_DEBUG, "Unable to read speed of at least one fan");
+#ifdef HAVE_LIBURING
+    }
+#endif
+
+    swp_stat.last = time_mono_us() - start;
+    swp_stat.sum += swp_stat.last;
+    swp_stat.max = (swp_stat.last > swp_stat.max) ? swp_stat.last : swp_stat.max;
+    swp_stat.cnt++;
+}
+
+
+long long swp_get_last(void) {
+    return swp_stat.last;
+}
+
+
+void swp_print(FILE *const file) {
+    if (!file)
+        return;
+
+    fprintf(file, "Sweep backend: %s\n", swp_name());
+    fprintf(file, "Sweeps: %lld\n", swp_stat.cnt);
+    fprintf(file, "Sweep time: last %lld us, avg %lld us, max %lld us\n", swp_stat.last,
+            (swp_stat.cnt > 0) ? swp_stat.sum / swp_stat.cnt : 0, swp_stat.max);
+}
+
+
+const char* swp_name(void) {
+#ifdef HAVE_LIBURING
+    if (swp.on)
+        return "io_uring";
+#endif
+    return "sync";
+}
+
+
+void swp_exit(void) {
+#ifdef HAVE_LIBURING
+    if (swp.on)
+        io_uring_queue_exit(&(swp.ring));
+    if (swp.ents)
+        free(swp.ents);
+
+    swp.on = 0;
+    swp.size = 0;
+    swp.ents = NULL;
+#endif
+}
@@ -0,0 +1,67 @@
+/**
+ * macfand - hipuranyhou - 16.10.2026
+ *
+ * Daemon for controlling fans on Linux systems using
+ * applesmc and coretemp.
+ *
+ * https://github.com/Hipuranyhou/macfand
+ */
+
+#ifndef MACFAND_SWEEP_H_mcnbvoeiru
+#define MACFAND_SWEEP_H_mcnbvoeiru
+
+#include <stdio.h>
+
+#include "linked.h"
+#include "monitor.h"
+
+/**
+ * @brief Prepares sweep backend.
+ * Prepares io_uring ring big enough for reading all monitors and fans in one submission if
+ * macfand was built with liburing and io_uring is enabled in settings. When io_uring is not
+ * available, synchronous backend is used.
+ * @param[in] mons Pointer to table of temperature monitors.
+ * @param[in] fans Pointer to head of generic linked list of system fans.
+ * @return int 0 on error, 1 on success.
+ */
+int swp_init(const t_mons *const mons, const t_node *fans);
+
+/**
+ * @brief Reads all monitors and fans.
+ * Reads current temperature of every monitor and current speed of every fan (none when fans is NULL),
+ * either using one io_uring submission or one synchronous read after another. When io_uring fails in
+ * the middle of sweep, reads which did not finish yet are done synchronously. Wall time of sweep is
+ * added to sweep statistics.
+ * @param[in,out] mons Pointer to table of temperature monitors.
+ * @param[in,out] fans Pointer to head of generic linked list of system fans.
+ */
+void swp_read(t_mons *const mons, t_node *fans);
+
+/**
+ * @brief Gets wall time of last sweep.
+ * Gets wall time of last sweep done by swp_read().
+ * @return long long wall time of last sweep in microseconds.
+ */
+long long swp_get_last(void);
+
+/**
+ * @brief Prints sweep statistics.
+ * Prints used sweep backend, number of sweeps and last, average and max wall time of sweeps to given file.
+ * @param[in] file File to which are statistics printed.
+ */
+void swp_print(FILE *const file);
+
+/**
+ * @brief Gets name of used sweep backend.
+ * Gets name of currently used sweep backend.
+ * @return const char* "io_uring" or "sync".
+ */
+const char* swp_name(void);
+
+/**
+ * @brief Frees sweep backend.
+ * Frees io_uring ring and buffers if they were used.
+ */
+void swp_exit(void);
+
+#endif //MACFAND_SWEEP_H_mcnbvoeiru
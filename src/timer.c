@@ -0,0 +1,162 @@
+/**
+ * macfand - hipuranyhou - 16.10.2026
+ *
+ * Daemon for controlling fans on Linux systems using
+ * applesmc and coretemp.
+ *
+ * https://github.com/Hipuranyhou/macfand
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/timerfd.h>
+
+#include "timer.h"
+#include "helper.h"
+#include "logger.h"
+
+/**
+ * @brief Upper bounds of histogram buckets.
+ * Upper bounds (exclusive, in microseconds) of wake up lateness histogram buckets, last bucket is unbounded.
+ */
+static const long long tmr_hist_max[TMR_HIST_CNT - 1] = {
+    100, 250, 500, 1000, 2500, 5000, 10000, 50000, 100000
+};
+
+
+t_tmr *tmr_init(void) {
+    t_tmr *tmr = NULL;
+    int   i    = 0;
+
+    tmr = (t_tmr*)malloc(sizeof(*tmr));
+    if (!tmr)
+        return NULL;
+
+    tmr->fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+    if (tmr->fd < 0) {
+        log_log(LOG_L_DEBUG, "Unable to create timerfd: %s", strerror(errno));
+        free(tmr);
+        return NULL;
+    }
+
+    tmr->dl = time_mono_us();
+    tmr->per = 0;
+    tmr->cycles = 0;
+    tmr->late = 0;
+    tmr->miss = 0;
+    for (i = 0; i < TMR_HIST_CNT; i++)
+        tmr->hist[i] = 0;
+
+    return tmr;
+}
+
+
+int tmr_fired(t_tmr *const tmr, const long long now) {
+    uint64_t  exp  = 0;
+    long long late = 0;
+    int       i    = 0;
+
+    if (!tmr)
+        return 0;
+
+    if (read(tmr->fd, &exp, sizeof(exp)) < 0 && errno != EAGAIN) {
+        log_log(LOG_L_DEBUG, "Unable to read timerfd: %s", strerror(errno));
+        return 0;
+    }
+
+    late = (now > tmr->dl) ? now - tmr->dl : 0;
+    for (i = 0; i < TMR_HIST_CNT - 1 && late >= tmr_hist_max[i]; i++)
+        ;
+    tmr->hist[i]++;
+    tmr->cycles++;
+    if (late > tmr->per / 10)
+        tmr->late++;
+
+    return 1;
+}
+
+
+int tmr_arm(t_tmr *const tmr, const int ms, const int fired) {
+    struct itimerspec its;
+    long long         now  = time_mono_us();
+    long long         per  = ms * 1000LL;
+    long long         skip = 0;
+
+    if (!tmr)
+        return 0;
+
+    // Cycle started early by alarm keeps its deadline unless it is too far
+    if (tmr->per == 0)
+        tmr->dl = now + per;
+    else if (fired)
+        tmr->dl += per;
+    else if (tmr->dl > now + per)
+        tmr->dl = now + per;
+    tmr->per = per;
+
+    // Deadlines passed while cycle was running are skipped, not run back to back
+    if (tmr->dl <= now) {
+        skip = (now - tmr->dl) / per + 1;
+        tmr->miss += skip;
+        tmr->dl += skip * per;
+        log_log(LOG_L_DEBUG, "Control cycle overran, skipping %lld cycles", skip);
+    }
+
+    its.it_interval.tv_sec = 0;
+    its.it_interval.tv_nsec = 0;
+    its.it_value.tv_sec = tmr->dl / 1000000;
+    its.it_value.tv_nsec = (tmr->dl % 1000000) * 1000;
+
+    if (timerfd_settime(tmr->fd, TFD_TIMER_ABSTIME, &its, NULL) < 0) {
+        log_log(LOG_L_DEBUG, "Unable to arm timerfd: %s", strerror(errno));
+        return 0;
+    }
+
+    return 1;
+}
+
+
+int tmr_stop(t_tmr *const tmr) {
+    struct itimerspec its;
+
+    if (!tmr)
+        return 0;
+
+    tmr->per = 0;
+    memset(&its, 0, sizeof(its));
+
+    if (timerfd_settime(tmr->fd, 0, &its, NULL) < 0) {
+        log_log(LOG_L_DEBUG, "Unable to disarm timerfd: %s", strerror(errno));
+        return 0;
+    }
+
+    return 1;
+}
+
+
+void tmr_free(t_tmr *tmr) {
+    if (!tmr)
+        return;
+
+    close(tmr->fd);
+    free(tmr);
+}
+
+
+void tmr_print(const t_tmr *const tmr, FILE *const file) {
+    int i = 0;
+
+    if (!tmr || !file)
+        return;
+
+    fprintf(file, "Cycles: %lld\n", tmr->cycles);
+    fprintf(file, "Late cycles: %lld\n", tmr->late);
+    fprintf(file, "Missed cycles: %lld\n", tmr->miss);
+    fprintf(file, "Wake up lateness:\n");
+    for (i = 0; i < TMR_HIST_CNT - 1; i++)
+        fprintf(file, "  < %6lld us: %lld\n", tmr_hist_max[i], tmr->hist[i]);
+    fprintf(file, "  >= %5lld us: %lld\n", tmr_hist_max[TMR_HIST_CNT - 2], tmr->hist[TMR_HIST_CNT - 1]);
+}
@@ -0,0 +1,87 @@
+/**
+ * macfand - hipuranyhou - 16.10.2026
+ *
+ * Daemon for controlling fans on Linux systems using
+ * applesmc and coretemp.
+ *
+ * https://github.com/Hipuranyhou/macfand
+ */
+
+#ifndef MACFAND_TIMER_H_mznxbcvlak
+#define MACFAND_TIMER_H_mznxbcvlak
+
+#include <stdio.h>
+
+#define TMR_HIST_CNT 10
+
+/**
+ * @brief Control loop timer type.
+ * Type for timer driving control loop by absolute deadlines on CLOCK_MONOTONIC. Holds timerfd, current deadline
+ * and poll time it was armed with (in microseconds, deadline is time_mono_us()), number of cycles started by
+ * timer, number of late cycles (woken up later than tenth of poll time after their deadline), number of missed
+ * cycles (deadline passed before previous cycle ended) and histogram of wake up lateness. Poll time 0 means timer
+ * is not running.
+ */
+typedef struct tmr {
+    int       fd;
+    long long dl;
+    long long per;
+    long long cycles;
+    long long late;
+    long long miss;
+    long long hist[TMR_HIST_CNT];
+} t_tmr;
+
+/**
+ * @brief Constructs control loop timer.
+ * Constructs control loop timer with first deadline at current time.
+ * @return t_tmr* NULL on error, pointer to timer otherwise (has to be freed by tmr_free()).
+ */
+t_tmr *tmr_init(void);
+
+/**
+ * @brief Accounts timer expiration.
+ * Clears expiration of given timer and adds its lateness at given time to statistics.
+ * @param[in,out] tmr Pointer to timer.
+ * @param[in]     now Current time in microseconds (time_mono_us()).
+ * @return int 0 on error, 1 on success.
+ */
+int tmr_fired(t_tmr *const tmr, const long long now);
+
+/**
+ * @brief Arms timer for next cycle.
+ * Arms given timer for next cycle given number of milliseconds after current deadline when cycle was started
+ * by timer, otherwise (cycle started early by alarm) deadline is only moved closer when needed. Timer which is not
+ * running is armed given number of milliseconds from now. Deadlines which passed during cycle are counted as missed
+ * and skipped.
+ * @param[in,out] tmr   Pointer to timer.
+ * @param[in]     ms    Poll time in milliseconds.
+ * @param[in]     fired Whether last cycle was started by timer.
+ * @return int 0 on error, 1 on success.
+ */
+int tmr_arm(t_tmr *const tmr, const int ms, const int fired);
+
+/**
+ * @brief Stops timer.
+ * Disarms given timer, so it does not fire until it is armed again.
+ * @param[in,out] tmr Pointer to timer.
+ * @return int 0 on error, 1 on success.
+ */
+int tmr_stop(t_tmr *const tmr);
+
+/**
+ * @brief Frees memory for given timer.
+ * Closes timerfd and calls free() on timer.
+ * @param[in] tmr Pointer to timer.
+ */
+void tmr_free(t_tmr *tmr);
+
+/**
+ * @brief Prints info about timer.
+ * Prints cycle counts and histogram of wake up lateness of given timer to given file.
+ * @param[in] tmr  Pointer to timer.
+ * @param[in] file File to which is info printed.
+ */
+void tmr_print(const t_tmr *const tmr, FILE *const file);
+
+#endif //MACFAND_TIMER_H_mznxbcvlak
@@ -0,0 +1,103 @@
+/**
+ * macfand - hipuranyhou - 16.10.2026
+ *
+ * Daemon for controlling fans on Linux systems using
+ * applesmc and coretemp.
+ *
+ * https://github.com/Hipuranyhou/macfand
+ */
+
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+
+#include "uevent.h"
+#include "helper.h"
+#include "logger.h"
+
+#define UEV_GRP_KERNEL 1
+#define UEV_HW_PREFIX  "/hwmon/hwmon"
+
+
+int uev_open(void) {
+    struct sockaddr_nl addr;
+    int                fd = -1;
+
+    fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, NETLINK_KOBJECT_UEVENT);
+    if (fd < 0) {
+        log_log(LOG_L_DEBUG, "Unable to create uevent socket: %s", strerror(errno));
+        return -1;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.nl_family = AF_NETLINK;
+    addr.nl_groups = UEV_GRP_KERNEL;
+
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        log_log(LOG_L_DEBUG, "Unable to bind uevent socket: %s", strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+
+int uev_read(const int fd, struct uev *const uev) {
+    ssize_t rd_ret = 0;
+    size_t  pos    = 0;
+    char    *key   = NULL;
+
+    if (fd < 0 || !uev)
+        return 0;
+
+    while ((rd_ret = recv(fd, uev->buf, sizeof(uev->buf) - 1, MSG_DONTWAIT)) > 0) {
+        uev->buf[rd_ret] = '\0';
+
+        // Kernel uevent starts with action@devpath header
+        if (!strchr(uev->buf, '@') || rd_ret == sizeof(uev->buf) - 1)
+            continue;
+
+        uev->act = UEV_A_OTHER;
+        uev->sub = "";
+        uev->dev = "";
+
+        // Payload is sequence of KEY=value strings separated by '\0'
+        for (pos = strlen(uev->buf) + 1; pos < (size_t)rd_ret; pos += strlen(key) + 1) {
+            key = uev->buf + pos;
+            if (strncmp(key, "ACTION=", 7) == 0) {
+                if (strcmp(key + 7, "add") == 0)
+                    uev->act = UEV_A_ADD;
+                else if (strcmp(key + 7, "remove") == 0)
+                    uev->act = UEV_A_REMOVE;
+            } else if (strncmp(key, "SUBSYSTEM=", 10) == 0)
+                uev->sub = key + 10;
+            else if (strncmp(key, "DEVPATH=", 8) == 0)
+                uev->dev = key + 8;
+        }
+
+        return 1;
+    }
+
+    if (rd_ret < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+        log_log(LOG_L_DEBUG, "Unable to read uevent: %s", strerror(errno));
+
+    return 0;
+}
+
+
+int uev_get_hw(const struct uev *const uev) {
+    const char *pos = NULL;
+    int        hw   = 0;
+
+    if (!uev || strcmp(uev->sub, "hwmon") != 0)
+        return -1;
+
+    pos = strstr(uev->dev, UEV_HW_PREFIX);
+    if (!pos || str_to_int(pos + strlen(UEV_HW_PREFIX), &hw, 10, NULL) < 1)
+        return -1;
+
+    return hw;
+}
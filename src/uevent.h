@@ -0,0 +1,62 @@
+/**
+ * macfand - hipuranyhou - 16.10.2026
+ *
+ * Daemon for controlling fans on Linux systems using
+ * applesmc and coretemp.
+ *
+ * https://github.com/Hipuranyhou/macfand
+ */
+
+#ifndef MACFAND_UEVENT_H_pwoqkdjzux
+#define MACFAND_UEVENT_H_pwoqkdjzux
+
+#define UEV_BUF_SIZE 4096
+
+/**
+ * @brief Enum holding uevent actions.
+ * Enum holding actions of kernel uevents macfand reacts to, all other actions are UEV_A_OTHER.
+ */
+enum uev_act {
+    UEV_A_OTHER,
+    UEV_A_ADD,
+    UEV_A_REMOVE
+};
+
+/**
+ * @brief Struct holding uevent.
+ * Struct holding action, subsystem and device path (relative to /sys) of kernel uevent. Subsystem and device
+ * path point into buffer of uevent and are empty strings when uevent does not carry them.
+ */
+struct uev {
+    enum uev_act act;
+    const char   *sub;
+    const char   *dev;
+    char         buf[UEV_BUF_SIZE];
+};
+
+/**
+ * @brief Opens uevent socket.
+ * Opens non-blocking netlink socket subscribed to kernel uevents.
+ * @return int -1 on error, file descriptor of socket otherwise.
+ */
+int uev_open(void);
+
+/**
+ * @brief Reads one uevent.
+ * Reads one pending kernel uevent from given socket into given uevent. Messages which are not kernel uevents
+ * (udev rebroadcasts, truncated messages) are skipped.
+ * @param[in]  fd  File descriptor of uevent socket.
+ * @param[out] uev Pointer to uevent.
+ * @return int 0 if no uevent is pending (or on error), 1 on success.
+ */
+int uev_read(const int fd, struct uev *const uev);
+
+/**
+ * @brief Gets hwmon index of uevent.
+ * Gets index of hwmon chip from device path of given uevent of hwmon subsystem.
+ * @param[in] uev Pointer to uevent.
+ * @return int -1 if uevent does not concern hwmon chip, index of hwmon chip otherwise.
+ */
+int uev_get_hw(const struct uev *const uev);
+
+#endif //MACFAND_UEVENT_H_pwoqkdjzux
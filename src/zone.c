@@ -0,0 +1,573 @@
+/**
+ * macfand - hipuranyhou - 16.10.2026
+ *
+ * Daemon for controlling fans on Linux systems using
+ * applesmc and coretemp.
+ *
+ * https://github.com/Hipuranyhou/macfand
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "zone.h"
+#include "fan.h"
+#include "helper.h"
+#include "settings.h"
+#include "logger.h"
+
+#define ZONE_SEP_ZONE ";"
+#define ZONE_SEP_KEY  " \t\n"
+#define ZONE_SEP_LIST ","
+#define ZONE_NAME_DEF "default"
+
+/**
+ * @brief Checks whether given selector matches given monitor.
+ * Checks whether given selector (all, chip, chip.idx, chip/mon or chip.idx/mon) matches given monitor.
+ * Selector is modified during check.
+ * @param[in] sel  Selector without weight.
+ * @param[in] info Pointer to information about monitor.
+ * @return int -1 on invalid selector, 0 if selector does not match monitor, 1 otherwise.
+ */
+static int zone_sel_mon(char *const sel, const struct mon_info *const info);
+
+/**
+ * @brief Parses monitors of zone.
+ * Adds every monitor matched by at least one selector of given comma separated list (selector can be followed
+ * by *weight) to given zone. Monitor matched by more selectors keeps the first weight.
+ * @param[in,out] zone Pointer to zone.
+ * @param[in]     val  List of selectors (modified during parsing).
+ * @param[in]     mons Pointer to table of temperature monitors.
+ * @return int 0 on error, 1 on success.
+ */
+static int zone_parse_mons(t_zone *const zone, char *const val, const t_mons *const mons);
+
+/**
+ * @brief Parses fans of zone.
+ * Adds every fan from given comma separated list of fan ids (or all) to given zone.
+ * @param[in,out] zone Pointer to zone.
+ * @param[in]     val  List of fan ids (modified during parsing).
+ * @param[in]     fans Pointer to head of generic linked list of system fans.
+ * @return int 0 on error, 1 on success.
+ */
+static int zone_parse_fans(t_zone *const zone, char *const val, const t_node *fans);
+
+/**
+ * @brief Parses aggregation function of zone.
+ * Parses aggregation function of zone, which is one of max, mean and pNN (NN-th percentile).
+ * @param[in,out] zone Pointer to zone.
+ * @param[in]     val  Name of aggregation function.
+ * @return int 0 on error, 1 on success.
+ */
+static int zone_parse_agg(t_zone *const zone, const char *const val);
+
+/**
+ * @brief Parses one zone.
+ * Parses whitespace separated name=, sensors=, fans= and agg= fields of given zone definition. Missing sensors
+ * and fans default to all, missing aggregation to max.
+ * @param[in,out] zone Pointer to allocated zone.
+ * @param[in]     def  Definition of zone (modified during parsing).
+ * @param[in]     mons Pointer to table of temperature monitors.
+ * @param[in]     fans Pointer to head of generic linked list of system fans.
+ * @return int 0 on error, 1 on success.
+ */
+static int zone_parse(t_zone *const zone, char *const def, const t_mons *const mons, const t_node *fans);
+
+/**
+ * @brief Allocates members of zone.
+ * Allocates name and arrays of given zone big enough for all monitors and fans and sets it to empty zone
+ * aggregated by max.
+ * @param[out] zone Pointer to zone.
+ * @param[in]  name Name of zone.
+ * @param[in]  mons Pointer to table of temperature monitors.
+ * @param[in]  fans Pointer to head of generic linked list of system fans.
+ * @return int 0 on error, 1 on success.
+ */
+static int zone_alloc(t_zone *const zone, const char *const name, const t_mons *const mons, const t_node *fans);
+
+/**
+ * @brief Adds default zone.
+ * Adds zone holding all monitors aggregated by max which drives every fan not driven by any zone in table.
+ * Nothing is added when every fan is already driven.
+ * @param[in,out] zones Pointer to table of thermal zones with room for one more zone.
+ * @param[in]     mons  Pointer to table of temperature monitors.
+ * @param[in]     fans  Pointer to head of generic linked list of system fans.
+ * @return int 0 on error, 1 on success.
+ */
+static int zones_load_def(t_zones *const zones, const t_mons *const mons, const t_node *fans);
+
+/**
+ * @brief Frees memory for given zone.
+ * Calls free() on all allocated members of given zone.
+ * @param[in] zone Pointer to zone.
+ */
+static void zone_free(t_zone *const zone);
+
+
+static int zone_sel_mon(char *const sel, const struct mon_info *const info) {
+    char *mon = NULL;
+    char *id  = NULL;
+    int  val  = 0;
+
+    if (strcmp(sel, "all") == 0)
+        return 1;
+
+    // chip.idx/mon
+    mon = strchr(sel, '/');
+    if (mon) {
+        *(mon++) = '\0';
+        if (str_to_int(mon, &val, 10, NULL) < 1)
+            return -1;
+        if (val != info->id.mon)
+            return 0;
+    }
+
+    id = strrchr(sel, '.');
+    if (id) {
+        *(id++) = '\0';
+        if (str_to_int(id, &val, 10, NULL) < 1)
+            return -1;
+        if (val != info->chip.id)
+            return 0;
+    }
+
+    return (strcmp(sel, info->chip.name) == 0);
+}
+
+
+static int zone_parse_mons(t_zone *const zone, char *const val, const t_mons *const mons) {
+    char *save    = NULL;
+    char *tok     = NULL;
+    char *wgt     = NULL;
+    char sel[64];
+    int  weight   = 1;
+    int  sel_ret  = 0;
+    int  i        = 0;
+    int  j        = 0;
+
+    for (tok = strtok_r(val, ZONE_SEP_LIST, &save); tok; tok = strtok_r(NULL, ZONE_SEP_LIST, &save)) {
+        weight = 1;
+        wgt = strchr(tok, '*');
+        if (wgt) {
+            *(wgt++) = '\0';
+            if (str_to_int(wgt, &weight, 10, NULL) < 1 || weight < 1) {
+                log_log(LOG_L_DEBUG, "Invalid weight %s of sensor %s in zone %s", wgt, tok, zone->name);
+                return 0;
+            }
+        }
+
+        if (strlen(tok) >= sizeof(sel)) {
+            log_log(LOG_L_DEBUG, "Sensor %s in zone %s is too long", tok, zone->name);
+            return 0;
+        }
+
+        for (i = 0; i < mons->cnt; i++) {
+            // Selector is modified by every check
+            strcpy(sel, tok);
+            sel_ret = zone_sel_mon(sel, &(mons->info[i]));
+            if (sel_ret < 0) {
+                log_log(LOG_L_DEBUG, "Invalid sensor %s in zone %s", tok, zone->name);
+                return 0;
+            }
+            if (sel_ret == 0)
+                continue;
+
+            for (j = 0; j < zone->mon_cnt && zone->mon[j] != i; j++)
+                ;
+            if (j < zone->mon_cnt)
+                continue;
+
+            zone->mon[zone->mon_cnt] = i;
+            zone->wgt[zone->mon_cnt] = weight;
+            zone->mon_cnt++;
+        }
+    }
+
+    if (zone->mon_cnt < 1) {
+        log_log(LOG_L_DEBUG, "Sensors of zone %s match no monitor", zone->name);
+        return 0;
+    }
+
+    return 1;
+}
+
+
+static int zone_parse_fans(t_zone *const zone, char *const val, const t_node *fans) {
+    const t_node *head = NULL;
+    char         *save = NULL;
+    char         *tok  = NULL;
+    int          id    = 0;
+
+    zone->fan_cnt = 0;
+
+    for (tok = strtok_r(val, ZONE_SEP_LIST, &save); tok; tok = strtok_r(NULL, ZONE_SEP_LIST, &save)) {
+        if (strcmp(tok, "all") == 0) {
+            zone->fan_cnt = 0;
+            for (head = fans; head; head = head->next)
+                zone->fan[zone->fan_cnt++] = ((const t_fan*)head->data)->id;
+            return 1;
+        }
+
+        if (str_to_int(tok, &id, 10, NULL) < 1) {
+            log_log(LOG_L_DEBUG, "Invalid fan %s in zone %s", tok, zone->name);
+            return 0;
+        }
+
+        for (head = fans; head && ((const t_fan*)head->data)->id != id; head = head->next)
+            ;
+        if (!head) {
+            log_log(LOG_L_DEBUG, "Fan %d of zone %s does not exist", id, zone->name);
+            return 0;
+        }
+
+        if (!zone_has_fan(zone, id))
+            zone->fan[zone->fan_cnt++] = id;
+    }
+
+    return 1;
+}
+
+
+static int zone_parse_agg(t_zone *const zone, const char *const val) {
+    if (strcmp(val, "max") == 0) {
+        zone->agg = ZONE_A_MAX;
+        return 1;
+    }
+
+    if (strcmp(val, "mean") == 0) {
+        zone->agg = ZONE_A_MEAN;
+        return 1;
+    }
+
+    if (val[0] == 'p' && str_to_int(val+1, &(zone->pct), 10, NULL) == 1 && zone->pct >= 0 && zone->pct <= 100) {
+        zone->agg = ZONE_A_PCT;
+        return 1;
+    }
+
+    log_log(LOG_L_DEBUG, "Invalid aggregation %s of zone %s", val, zone->name);
+    return 0;
+}
+
+
+static int zone_parse(t_zone *const zone, char *const def, const t_mons *const mons, const t_node *fans) {
+    char       *save      = NULL;
+    char       *tok       = NULL;
+    char       *val       = NULL;
+    char       *sens      = NULL;
+    char       *fan       = NULL;
+    char       *agg       = NULL;
+    char       all_mons[] = "all";
+    char       all_fans[] = "all";
+    const char *name      = ZONE_NAME_DEF;
+
+    for (tok = strtok_r(def, ZONE_SEP_KEY, &save); tok; tok = strtok_r(NULL, ZONE_SEP_KEY, &save)) {
+        val = strchr(tok, '=');
+        if (!val) {
+            log_log(LOG_L_DEBUG, "Invalid zone field %s", tok);
+            return 0;
+        }
+        *(val++) = '\0';
+
+        if (strcmp(tok, "name") == 0)
+            name = val;
+        else if (strcmp(tok, "sensors") == 0)
+            sens = val;
+        else if (strcmp(tok, "fans") == 0)
+            fan = val;
+        else if (strcmp(tok, "agg") == 0)
+            agg = val;
+        else {
+            log_log(LOG_L_DEBUG, "Unknown zone field %s", tok);
+            return 0;
+        }
+    }
+
+    if (!zone_alloc(zone, name, mons, fans))
+        return 0;
+
+    if (!zone_parse_mons(zone, (sens) ? sens : all_mons, mons))
+        return 0;
+
+    // Zone holding every monitor can use fast max reduction
+    zone->all = (zone->mon_cnt == mons->cnt);
+
+    if (!zone_parse_fans(zone, (fan) ? fan : all_fans, fans))
+        return 0;
+
+    if (agg && !zone_parse_agg(zone, agg))
+        return 0;
+
+    return 1;
+}
+
+
+static int zone_alloc(t_zone *const zone, const char *const name, const t_mons *const mons, const t_node *fans) {
+    int fan_cnt = 0;
+
+    for (; fans; fans = fans->next)
+        fan_cnt++;
+
+    zone->name = (char*)malloc(strlen(name)+1);
+    zone->mon = (int*)malloc(3 * (mons->cnt + 1) * sizeof(*(zone->mon)));
+    zone->fan = (int*)malloc((fan_cnt + 1) * sizeof(*(zone->fan)));
+    if (!zone->name || !zone->mon || !zone->fan)
+        return 0;
+
+    strcpy(zone->name, name);
+    zone->wgt = zone->mon + mons->cnt + 1;
+    zone->buf = zone->wgt + mons->cnt + 1;
+    zone->agg = ZONE_A_MAX;
+    zone->pct = 100;
+    zone->all = 0;
+    zone->mon_cnt = 0;
+    zone->fan_cnt = 0;
+
+    zone->temps.prev = 0;
+    zone->temps.real = 0;
+    zone->temps.rate = 0;
+    zone->temps.time = 0;
+    zone->temps.high = set_get_int(SET_TEMP_HIGH);
+    zone->temps.low = set_get_int(SET_TEMP_LOW);
+    zone->temps.max = set_get_int(SET_TEMP_MAX);
+
+    zone->pid.integ = 0;
+    zone->pid.deriv = 0;
+    zone->pid.time = 0;
+    zone->pid.out = 0;
+
+    memset(&(zone->mpc), 0, sizeof(zone->mpc));
+    zone->mpc.ttm = -1;
+
+    return 1;
+}
+
+
+static int zones_load_def(t_zones *const zones, const t_mons *const mons, const t_node *fans) {
+    t_zone       *zone = &(zones->zone[zones->cnt]);
+    const t_node *head = NULL;
+    int          id    = 0;
+    int          i     = 0;
+
+    zones->cnt++;
+    if (!zone_alloc(zone, ZONE_NAME_DEF, mons, fans))
+        return 0;
+
+    for (i = 0; i < mons->cnt; i++) {
+        zone->mon[i] = i;
+        zone->wgt[i] = 1;
+    }
+    zone->mon_cnt = mons->cnt;
+    zone->all = 1;
+
+    // Collect fans not driven by any other zone
+    for (head = fans; head; head = head->next) {
+        id = ((const t_fan*)head->data)->id;
+        for (i = 0; i < zones->cnt - 1 && !zone_has_fan(&(zones->zone[i]), id); i++)
+            ;
+        if (i == zones->cnt - 1)
+            zone->fan[zone->fan_cnt++] = id;
+    }
+
+    if (zone->fan_cnt > 0) {
+        if (zones->cnt > 1)
+            log_log(LOG_L_INFO, "%d fans are not driven by any zone, using zone %s for them", zone->fan_cnt, zone->name);
+        return 1;
+    }
+
+    zones->cnt--;
+    zone_free(zone);
+    return 1;
+}
+
+
+static void zone_free(t_zone *const zone) {
+    if (zone->name)
+        free(zone->name);
+    if (zone->mon)
+        free(zone->mon);
+    if (zone->fan)
+        free(zone->fan);
+
+    zone->name = NULL;
+    zone->mon = NULL;
+    zone->fan = NULL;
+}
+
+
+t_zones* zones_load(const t_mons *const mons, const t_node *fans) {
+    t_zones    *zones = NULL;
+    const char *cfg   = set_get_str(SET_ZONES);
+    char       *defs  = NULL;
+    char       *save  = NULL;
+    char       *def   = NULL;
+    int        cap    = 1;
+    int        i      = 0;
+
+    if (!mons || mons->cnt < 1)
+        return NULL;
+
+    zones = (t_zones*)calloc(1, sizeof(*zones));
+    if (!zones)
+        return NULL;
+
+    // Default zone is always counted
+    if (cfg)
+        for (i = 0; cfg[i]; i++)
+            cap += (cfg[i] == ';');
+    cap++;
+
+    zones->zone = (t_zone*)calloc(cap, sizeof(*(zones->zone)));
+    defs = (char*)malloc(((cfg) ? strlen(cfg) : 0) + 1);
+    if (!zones->zone || !defs) {
+        if (defs)
+            free(defs);
+        zones_free(zones);
+        return NULL;
+    }
+    strcpy(defs, (cfg) ? cfg : "");
+
+    for (def = strtok_r(defs, ZONE_SEP_ZONE, &save); def; def = strtok_r(NULL, ZONE_SEP_ZONE, &save)) {
+        // Skip empty definitions
+        while (*def == ' ' || *def == '\t' || *def == '\n')
+            def++;
+        if (*def == '\0')
+            continue;
+
+        zones->cnt++;
+        if (!zone_parse(&(zones->zone[zones->cnt-1]), def, mons, fans)) {
+            log_log(LOG_L_DEBUG, "Unable to parse zone %d", zones->cnt);
+            free(defs);
+            zones_free(zones);
+            return NULL;
+        }
+    }
+    free(defs);
+
+    if (!zones_load_def(zones, mons, fans)) {
+        zones_free(zones);
+        return NULL;
+    }
+
+    for (i = 0; i < zones->cnt; i++)
+        log_log(LOG_L_INFO, "Using zone %s with %d monitors and %d fans", zones->zone[i].name,
+                zones->zone[i].mon_cnt, zones->zone[i].fan_cnt);
+
+    return zones;
+}
+
+
+int zone_get_temp(t_zone *const zone, const t_mons *const mons) {
+    const int *temps = mons->temp;
+    long long sum    = 0;
+    long long wgt    = 0;
+    int       temp   = MON_TEMP_INV;
+    int       cnt    = 0;
+    int       i      = 0;
+    int       j      = 0;
+
+    if (zone->agg == ZONE_A_MAX && zone->all)
+        return mons_get_temp(mons);
+
+    switch (zone->agg) {
+        case ZONE_A_MAX:
+            for (i = 0; i < zone->mon_cnt; i++)
+                temp = max(temp, temps[zone->mon[i]]);
+            break;
+
+        case ZONE_A_MEAN:
+            for (i = 0; i < zone->mon_cnt; i++) {
+                if (temps[zone->mon[i]] == MON_TEMP_INV)
+                    continue;
+                sum += (long long)zone->wgt[i] * temps[zone->mon[i]];
+                wgt += zone->wgt[i];
+            }
+            if (wgt > 0)
+                temp = sum / wgt;
+            break;
+
+        case ZONE_A_PCT:
+            // Insertion sort of valid temperatures, zones are small
+            for (i = 0; i < zone->mon_cnt; i++) {
+                temp = temps[zone->mon[i]];
+                if (temp == MON_TEMP_INV)
+                    continue;
+                for (j = cnt; j > 0 && zone->buf[j-1] > temp; j--)
+                    zone->buf[j] = zone->buf[j-1];
+                zone->buf[j] = temp;
+                cnt++;
+            }
+            // Nearest rank
+            temp = MON_TEMP_INV;
+            if (cnt > 0)
+                temp = zone->buf[max((zone->pct * cnt + 99) / 100 - 1, 0)];
+            break;
+    }
+
+    // If failed to load at least one temperature, crank up the fans
+    if (temp < 0) {
+        log_log(LOG_L_ERROR, "Unable to read temperature from monitors of zone %s.", zone->name);
+        return set_get_int(SET_TEMP_HIGH) * 1000;
+    }
+
+    return temp;
+}
+
+
+int zone_has_fan(const t_zone *const zone, const int id) {
+    int i = 0;
+
+    for (i = 0; i < zone->fan_cnt; i++)
+        if (zone->fan[i] == id)
+            return 1;
+
+    return 0;
+}
+
+
+void zones_free(t_zones *zones) {
+    int i = 0;
+
+    if (!zones)
+        return;
+
+    if (zones->zone) {
+        for (i = 0; i < zones->cnt; i++)
+            zone_free(&(zones->zone[i]));
+        free(zones->zone);
+    }
+
+    free(zones);
+}
+
+
+void zones_print(const t_zones *const zones, FILE *const file) {
+    static const char *const aggs[] = {"max", "mean", "p"};
+    const t_zone             *zone  = NULL;
+    int                      i      = 0;
+    int                      j      = 0;
+
+    if (!zones || !file)
+        return;
+
+    for (i = 0; i < zones->cnt; i++) {
+        zone = &(zones->zone[i]);
+        fprintf(file, "Zone %s\n", zone->name);
+        fprintf(file, "Aggregation: %s", aggs[zone->agg]);
+        if (zone->agg == ZONE_A_PCT)
+            fprintf(file, "%d", zone->pct);
+        fprintf(file, "\nTemp: %d.%03d°C\n", zone->temps.real / 1000, abs(zone->temps.real % 1000));
+        fprintf(file, "Rate: %d m°C/s\n", zone->temps.rate);
+        fprintf(file, "PID output: %.3f\n", zone->pid.out);
+        fprintf(file, "MPC model: dT/dt = %.4f + %.4f * u + %.5f * x (%d samples, %s)\n", zone->mpc.theta[0],
+                zone->mpc.theta[1], zone->mpc.theta[2], zone->mpc.cnt, (zone->mpc.ok) ? "valid" : "learning");
+        fprintf(file, "MPC output: %.3f\n", zone->mpc.out);
+        if (zone->mpc.ttm < 0)
+            fprintf(file, "Time to temp_max: never\n");
+        else
+            fprintf(file, "Time to temp_max: %.0f s\n", zone->mpc.ttm);
+        fprintf(file, "Monitors: %d\nFans:", zone->mon_cnt);
+        for (j = 0; j < zone->fan_cnt; j++)
+            fprintf(file, " %d", zone->fan[j]);
+        fprintf(file, "\n\n");
+    }
+}
@@ -0,0 +1,108 @@
+/**
+ * macfand - hipuranyhou - 16.10.2026
+ *
+ * Daemon for controlling fans on Linux systems using
+ * applesmc and coretemp.
+ *
+ * https://github.com/Hipuranyhou/macfand
+ */
+
+#ifndef MACFAND_ZONE_H_zlaksjdhfg
+#define MACFAND_ZONE_H_zlaksjdhfg
+
+#include <stdio.h>
+
+#include "linked.h"
+#include "monitor.h"
+#include "control.h"
+
+/**
+ * @brief Enum holding zone aggregation functions.
+ * Enum holding functions used to aggregate temperatures of all monitors of zone into one temperature,
+ * which are max, weighted mean and percentile.
+ */
+enum zone_agg {
+    ZONE_A_MAX,
+    ZONE_A_MEAN,
+    ZONE_A_PCT
+};
+
+/**
+ * @brief Zone type.
+ * Type for thermal zone holding its name, aggregation function (and percentile for ZONE_A_PCT), indexes
+ * of its monitors in table of monitors with their weights, scratch buffer used by aggregation, ids of
+ * fans driven by zone, control temperatures of zone and state of its PID and model-predictive controllers.
+ * Zone with all set holds every monitor in table.
+ */
+typedef struct zone {
+    char              *name;
+    enum zone_agg     agg;
+    int               pct;
+    int               all;
+    int               mon_cnt;
+    int               *mon;
+    int               *wgt;
+    int               *buf;
+    int               fan_cnt;
+    int               *fan;
+    struct ctrl_temps temps;
+    struct ctrl_pid   pid;
+    struct ctrl_mpc   mpc;
+} t_zone;
+
+/**
+ * @brief Table of thermal zones.
+ * Table holding number of zones and array of zones.
+ */
+typedef struct zones {
+    int    cnt;
+    t_zone *zone;
+} t_zones;
+
+/**
+ * @brief Constructs table of thermal zones.
+ * Constructs table of thermal zones from zones setting. Every zone maps selected monitors to selected fans.
+ * When zones are not configured, one zone holding all monitors and all fans aggregated by max is used.
+ * Fans which are not driven by any configured zone are put into additional zone of the same kind.
+ * @param[in] mons Pointer to table of temperature monitors.
+ * @param[in] fans Pointer to head of generic linked list of system fans.
+ * @return t_zones* NULL on error, pointer to table of thermal zones otherwise (has to be freed by zones_free()).
+ */
+t_zones *zones_load(const t_mons *const mons, const t_node *fans);
+
+/**
+ * @brief Gets the current temperature of given zone.
+ * Gets the current temperature of given zone (in millidegrees) aggregated from temperatures of its monitors read
+ * by last mons_read_temp() or sweep. Excluded monitors (holding MON_TEMP_INV) are skipped.
+ * @param[in,out] zone Pointer to zone (its scratch buffer is used).
+ * @param[in]     mons Pointer to table of temperature monitors.
+ * @return int settings_get_value(SET_TEMP_HIGH) (in millidegrees) if no monitor of zone holds valid temperature,
+ * current temperature of zone otherwise.
+ */
+int zone_get_temp(t_zone *const zone, const t_mons *const mons);
+
+/**
+ * @brief Checks whether given zone drives given fan.
+ * Checks whether fan with given id is amongst fans driven by given zone.
+ * @param[in] zone Pointer to zone.
+ * @param[in] id   Id of fan.
+ * @return int 0 if zone does not drive fan, 1 otherwise.
+ */
+int zone_has_fan(const t_zone *const zone, const int id);
+
+/**
+ * @brief Frees memory for given table of zones.
+ * Calls free() on all members of every zone, array of zones and table itself.
+ * @param[in] zones Pointer to table of thermal zones.
+ */
+void zones_free(t_zones *zones);
+
+/**
+ * @brief Prints info about zones.
+ * Prints formated information about every zone in given table to given file.
+ * @param[in] zones Pointer to table of thermal zones.
+ * @param[in] file  File to which is info printed.
+ */
+void zones_print(const t_zones *const zones, FILE *const file);
+
+#endif //MACFAND_ZONE_H_zlaksjdhfg
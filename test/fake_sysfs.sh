@@ -0,0 +1,172 @@
+#!/bin/sh
+#
+# macfand - hipuranyhou - 16.10.2026
+#
+# Runs macfand against fake sysfs trees (coretemp with applesmc
+# and coretemp with nct6775 pwm chip) and checks fan discovery,
+# manual mode, speed writes and restore of previous fan modes.
+#
+# Usage: test/fake_sysfs.sh [path to macfand binary]
+#
+
+EXEC=${1:-bin/macfand}
+TMP=$(mktemp -d) || exit 1
+FAIL=0
+PID=
+
+trap 'kill "$PID" 2>/dev/null; rm -rf "$TMP"' EXIT
+
+# file value - writes value into file (creating its directory)
+put() {
+    mkdir -p "$(dirname "$1")" && printf '%s\n' "$2" > "$1"
+}
+
+# file - prints first line of file
+val() {
+    head -n 1 "$1" 2>/dev/null
+}
+
+# name got want - compares values
+expect() {
+    if [ "$2" = "$3" ]; then
+        echo "  ok   $1 = $2"
+    else
+        echo "  FAIL $1 = $2 (expected $3)"
+        FAIL=1
+    fi
+}
+
+# name got min max - checks value is within range
+expect_rng() {
+    if [ -n "$2" ] && [ "$2" -ge "$3" ] && [ "$2" -le "$4" ]; then
+        echo "  ok   $1 = $2"
+    else
+        echo "  FAIL $1 = $2 (expected $3..$4)"
+        FAIL=1
+    fi
+}
+
+# root - builds coretemp monitor (hot enough for fans to spin up)
+mk_coretemp() {
+    dev=$1/devices/platform/coretemp.0/hwmon/hwmon0
+    put "$dev/name" coretemp
+    put "$dev/temp1_input" 85000
+    put "$dev/temp1_max" 90000
+    put "$dev/temp1_label" "Package id 0"
+    mkdir -p "$1/class/hwmon"
+    ln -s ../../devices/platform/coretemp.0/hwmon/hwmon0 "$1/class/hwmon/hwmon0"
+}
+
+# root - builds applesmc with two fans (output outside of range until written)
+mk_smc() {
+    dev=$1/devices/platform/applesmc.768
+    for i in 1 2; do
+        put "$dev/fan${i}_label" "Fan $i"
+        put "$dev/fan${i}_min" 2000
+        put "$dev/fan${i}_max" 6000
+        put "$dev/fan${i}_input" 2000
+        put "$dev/fan${i}_output" 0
+        put "$dev/fan${i}_manual" 0
+    done
+}
+
+# root - builds nct6775 with two pwm fans (stopped until written) and one pwm channel without tachometer
+mk_pwm() {
+    dev=$1/devices/platform/nct6775.656/hwmon/hwmon1
+    put "$dev/name" nct6798
+    put "$dev/fan1_label" "CPU Fan"
+    put "$dev/fan1_input" 1100
+    put "$dev/fan2_input" 900
+    put "$dev/pwm1" 0
+    put "$dev/pwm1_enable" 5
+    put "$dev/pwm2" 0
+    put "$dev/pwm2_enable" 2
+    put "$dev/pwm3" 128
+    put "$dev/pwm3_enable" 1
+    ln -s ../../devices/platform/nct6775.656/hwmon/hwmon1 "$1/class/hwmon/hwmon1"
+}
+
+# name backend [settings] - runs macfand on $TMP/name and waits for first control cycles
+run() {
+    cat > "$TMP/$1.conf" <<EOF
+daemon:           "no"
+log_type:         "file"
+log_file_path:    "$TMP/$1.log"
+status_file_path: "$TMP/$1.status"
+sensors:          "coretemp"
+sysfs_root:       "$TMP/$1"
+fan_backend:      "$2"
+$3
+EOF
+    "$EXEC" --config="$TMP/$1.conf" >"$TMP/$1.out" 2>&1 &
+    PID=$!
+    sleep 3
+    if ! kill -0 "$PID" 2>/dev/null; then
+        echo "  FAIL macfand exited on start, log:"
+        cat "$TMP/$1.out" "$TMP/$1.log" 2>/dev/null
+        FAIL=1
+        PID=
+        return 1
+    fi
+    return 0
+}
+
+# stops macfand and waits until it restores fans
+stop() {
+    kill -TERM "$PID"
+    wait "$PID"
+    PID=
+}
+
+if [ ! -x "$EXEC" ]; then
+    echo "Binary $EXEC not found, run make first"
+    exit 1
+fi
+
+echo "applesmc backend"
+mk_coretemp "$TMP/smc"
+mk_smc "$TMP/smc"
+SMC=$TMP/smc/devices/platform/applesmc.768
+if run smc applesmc; then
+    expect "fan1_manual" "$(val "$SMC/fan1_manual")" 1
+    expect "fan2_manual" "$(val "$SMC/fan2_manual")" 1
+    expect_rng "fan1_output" "$(val "$SMC/fan1_output")" 2000 6000
+    expect_rng "fan2_output" "$(val "$SMC/fan2_output")" 2000 6000
+    stop
+    expect "fan1_manual restored" "$(val "$SMC/fan1_manual")" 0
+    expect "fan2_manual restored" "$(val "$SMC/fan2_manual")" 0
+fi
+
+echo "slew override (pid over temp_max)"
+mk_coretemp "$TMP/ovr"
+mk_smc "$TMP/ovr"
+put "$TMP/ovr/devices/platform/coretemp.0/hwmon/hwmon0/temp1_input" 95000
+SMC=$TMP/ovr/devices/platform/applesmc.768
+if run ovr applesmc "ctrl_mode:        \"pid\"
+fan_slew:         100"; then
+    expect "fan1_output" "$(val "$SMC/fan1_output")" 6000
+    expect "fan2_output" "$(val "$SMC/fan2_output")" 6000
+    stop
+fi
+
+echo "pwm backend"
+mk_coretemp "$TMP/pwm"
+mk_pwm "$TMP/pwm"
+PWM=$TMP/pwm/devices/platform/nct6775.656/hwmon/hwmon1
+if run pwm pwm; then
+    expect "pwm1_enable" "$(val "$PWM/pwm1_enable")" 1
+    expect "pwm2_enable" "$(val "$PWM/pwm2_enable")" 1
+    expect "pwm3_enable (no tachometer)" "$(val "$PWM/pwm3_enable")" 1
+    expect "pwm3 (no tachometer)" "$(val "$PWM/pwm3")" 128
+    expect_rng "pwm1" "$(val "$PWM/pwm1")" 1 255
+    expect_rng "pwm2" "$(val "$PWM/pwm2")" 1 255
+    stop
+    expect "pwm1_enable restored" "$(val "$PWM/pwm1_enable")" 5
+    expect "pwm2_enable restored" "$(val "$PWM/pwm2_enable")" 2
+fi
+
+if [ "$FAIL" -ne 0 ]; then
+    echo "FAILED"
+    exit 1
+fi
+echo "PASSED"
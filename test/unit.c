@@ -0,0 +1,290 @@
+/**
+ * macfand - hipuranyhou - 16.10.2026
+ *
+ * Daemon for controlling fans on Linux systems using
+ * applesmc and coretemp.
+ *
+ * https://github.com/Hipuranyhou/macfand
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Controllers are static, so control loop is built into tests instead of being linked
+#include "../src/control.c"
+
+// Checks of sysfs parser, speed curves, zone aggregation and PID controller without sysfs
+
+#define UNIT_US 1000000LL
+
+/**
+ * @brief Number of failed checks.
+ */
+static int fails = 0;
+
+/**
+ * @brief Compares integers.
+ * Compares given integer with expected one and prints result of check.
+ * @param[in] name Name of check.
+ * @param[in] got  Checked value.
+ * @param[in] want Expected value.
+ */
+static void expect(const char *const name, const long long got, const long long want);
+
+/**
+ * @brief Compares doubles.
+ * Checks whether given double is within given range and prints result of check.
+ * @param[in] name Name of check.
+ * @param[in] got  Checked value.
+ * @param[in] min  Lowest allowed value.
+ * @param[in] max  Highest allowed value.
+ */
+static void expect_rng(const char *const name, const double got, const double min, const double max);
+
+/**
+ * @brief Parses value using sysfs_to_int().
+ * Parses given string as content of sysfs attribute (without null byte).
+ * @param[in] str String to be parsed.
+ * @return long long -1 when string was rejected, parsed value otherwise (of which -1 is also valid).
+ */
+static long long unit_parse(const char *const str);
+
+/**
+ * @brief Checks sysfs attribute parser.
+ * Checks values accepted and rejected by sysfs_to_int() including limits of int.
+ */
+static void unit_parser(void);
+
+/**
+ * @brief Checks speed curves.
+ * Checks speeds of default curve at both branches, hysteresis between them, full speed over temp_max and
+ * user curves.
+ */
+static void unit_curve(void);
+
+/**
+ * @brief Checks zone aggregation.
+ * Checks max, weighted mean and percentiles of zone with excluded monitor and zone without valid monitors.
+ */
+static void unit_zone(void);
+
+/**
+ * @brief Checks PID controller.
+ * Checks that integral of PID controller of zone accumulates while output is not saturated and is frozen
+ * while output is saturated at max and at min (anti-windup).
+ */
+static void unit_pid(void);
+
+
+static void expect(const char *const name, const long long got, const long long want) {
+    if (got == want) {
+        printf("  ok   %s = %lld\n", name, got);
+        return;
+    }
+
+    printf("  FAIL %s = %lld (expected %lld)\n", name, got, want);
+    fails++;
+}
+
+
+static void expect_rng(const char *const name, const double got, const double min, const double max) {
+    if (got >= min && got <= max) {
+        printf("  ok   %s = %g\n", name, got);
+        return;
+    }
+
+    printf("  FAIL %s = %g (expected %g..%g)\n", name, got, min, max);
+    fails++;
+}
+
+
+static long long unit_parse(const char *const str) {
+    int val = 0;
+
+    if (!sysfs_to_int(str, strlen(str), &val))
+        return -1;
+
+    return val;
+}
+
+
+static void unit_parser(void) {
+    printf("sysfs parser\n");
+    expect("\"45000\\n\"", unit_parse("45000\n"), 45000);
+    expect("\"0\" (no newline)", unit_parse("0"), 0);
+    expect("\"-40000\\n\"", unit_parse("-40000\n"), -40000);
+    expect("\"2147483647\\n\"", unit_parse("2147483647\n"), 2147483647LL);
+    expect("\"-2147483648\\n\"", unit_parse("-2147483648\n"), -2147483648LL);
+    expect("\"2147483648\\n\" rejected", unit_parse("2147483648\n"), -1);
+    expect("\"\" rejected", unit_parse(""), -1);
+    expect("\"\\n\" rejected", unit_parse("\n"), -1);
+    expect("\"-\\n\" rejected", unit_parse("-\n"), -1);
+    expect("\"12a\\n\" rejected", unit_parse("12a\n"), -1);
+    expect("\" 12\\n\" rejected", unit_parse(" 12\n"), -1);
+    expect("\"12\\n\\n\" rejected", unit_parse("12\n\n"), -1);
+}
+
+
+static void unit_curve(void) {
+    t_fan fan;
+
+    printf("speed curve\n");
+    memset(&fan, 0, sizeof(fan));
+    fan.spd.min = 2000;
+    fan.spd.max = 6000;
+
+    // Default curve rises from temp_high (66) and falls to temp_low (63), full speed at temp_max (84)
+    set_set_int(SET_TEMP_LOW, 63);
+    set_set_int(SET_TEMP_HIGH, 66);
+    set_set_int(SET_TEMP_MAX, 84);
+    expect("default curve compiled", crv_load(&fan), 1);
+
+    fan.cmd.spd = 2000;
+    expect("60C from min", crv_get_spd(&fan, 60000), 2000);
+    expect("70C from min (rising branch)", crv_get_spd(&fan, 70000), 2234);
+    fan.cmd.spd = 3000;
+    expect("70C from 3000 (falling branch)", crv_get_spd(&fan, 70000), 2485);
+    fan.cmd.spd = 2400;
+    expect("70C from 2400 (kept between branches)", crv_get_spd(&fan, 70000), 2400);
+    expect("64C from 2400 (lowered on falling branch)", crv_get_spd(&fan, 64000), 2017);
+    fan.cmd.spd = 2000;
+    expect("84C from min", crv_get_spd(&fan, 84000), 6000);
+    expect("200C from min (end of table)", crv_get_spd(&fan, 200000), 6000);
+    expect("-5C from min (start of table)", crv_get_spd(&fan, -5000), 2000);
+
+    // User curves, falling one above rising one
+    set_set_str(SET_CURVE, "40:0 80:100");
+    set_set_str(SET_CURVE_FALL, "30:0 70:100");
+    expect("user curve compiled", crv_load(&fan), 1);
+    expect("60C from min (rising 50%)", crv_get_spd(&fan, 60000), 4000);
+    fan.cmd.spd = 6000;
+    expect("60C from max (falling 75%)", crv_get_spd(&fan, 60000), 5000);
+    fan.cmd.spd = 4500;
+    expect("60C from 4500 (kept between branches)", crv_get_spd(&fan, 60000), 4500);
+
+    set_set_str(SET_CURVE, "50:0 40:100");
+    expect("falling temperatures rejected", crv_load(&fan), 0);
+    set_set_str(SET_CURVE, "40:0 80:101");
+    expect("speed over 100% rejected", crv_load(&fan), 0);
+    expect("old curve kept", crv_get_spd(&fan, 60000), 4500);
+
+    // Curves can not be unset by setters
+    set_reset();
+    free(fan.crv.rise);
+}
+
+
+static void unit_zone(void) {
+    int     temps[] = {50000, 70000, MON_TEMP_INV, 60000, 90000};
+    int     mon[]   = {0, 1, 2, 3, 4};
+    int     wgt[]   = {1, 3, 5, 1, 1};
+    int     inv[]   = {MON_TEMP_INV, MON_TEMP_INV};
+    int     buf[5];
+    t_mons  mons;
+    t_zone  zone;
+
+    printf("zone aggregation\n");
+    memset(&mons, 0, sizeof(mons));
+    memset(&zone, 0, sizeof(zone));
+    mons.cnt = 5;
+    mons.temp = temps;
+    zone.name = "test";
+    zone.mon_cnt = 5;
+    zone.mon = mon;
+    zone.wgt = wgt;
+    zone.buf = buf;
+
+    zone.agg = ZONE_A_MAX;
+    expect("max", zone_get_temp(&zone, &mons), 90000);
+
+    // Excluded monitor and its weight are skipped
+    zone.agg = ZONE_A_MEAN;
+    expect("weighted mean", zone_get_temp(&zone, &mons), (50000 + 3 * 70000 + 60000 + 90000) / 6);
+
+    // Nearest rank of 50000, 60000, 70000 and 90000
+    zone.agg = ZONE_A_PCT;
+    zone.pct = 0;
+    expect("p0", zone_get_temp(&zone, &mons), 50000);
+    zone.pct = 25;
+    expect("p25", zone_get_temp(&zone, &mons), 50000);
+    zone.pct = 50;
+    expect("p50", zone_get_temp(&zone, &mons), 60000);
+    zone.pct = 75;
+    expect("p75", zone_get_temp(&zone, &mons), 70000);
+    zone.pct = 76;
+    expect("p76", zone_get_temp(&zone, &mons), 90000);
+    zone.pct = 100;
+    expect("p100", zone_get_temp(&zone, &mons), 90000);
+
+    // Zone without valid temperature cranks fans up
+    set_set_int(SET_TEMP_HIGH, 66);
+    mons.temp = inv;
+    zone.mon_cnt = 2;
+    zone.agg = ZONE_A_MEAN;
+    expect("mean of excluded monitors", zone_get_temp(&zone, &mons), 66000);
+    zone.agg = ZONE_A_PCT;
+    expect("p50 of excluded monitors", zone_get_temp(&zone, &mons), 66000);
+}
+
+
+static void unit_pid(void) {
+    t_zone    zone;
+    long long now = UNIT_US;
+    int       i   = 0;
+
+    printf("pid controller\n");
+    memset(&zone, 0, sizeof(zone));
+    set_set_int(SET_PID_TARGET, 72);
+    set_set_dbl(SET_PID_KP, 0.08);
+    set_set_dbl(SET_PID_KI, 0.004);
+    set_set_dbl(SET_PID_KD, 0.1);
+    set_set_dbl(SET_PID_TAU, 2);
+
+    // 3°C over target for 10 s, output stays under max
+    zone.temps.real = 75000;
+    for (i = 0; i <= 10; i++, now += UNIT_US)
+        ctrl_calc_pid(&zone, now);
+    expect_rng("integral under max", zone.pid.integ, 29.999, 30.001);
+    expect_rng("output under max", zone.pid.out, 0.3599, 0.3601);
+
+    // 18°C over target for 100 s saturates output, integral is frozen
+    zone.temps.real = 90000;
+    for (i = 0; i < 100; i++, now += UNIT_US)
+        ctrl_calc_pid(&zone, now);
+    expect_rng("integral at max", zone.pid.integ, 29.999, 30.001);
+    expect_rng("output at max", zone.pid.out, 1, 1);
+
+    // Back at target output falls right away instead of unwinding
+    zone.temps.real = 72000;
+    ctrl_calc_pid(&zone, now);
+    now += UNIT_US;
+    expect_rng("output back at target", zone.pid.out, 0.1199, 0.1201);
+
+    // 12°C under target for 100 s saturates output at min, integral is frozen again
+    zone.temps.real = 60000;
+    for (i = 0; i < 100; i++, now += UNIT_US)
+        ctrl_calc_pid(&zone, now);
+    expect_rng("integral at min", zone.pid.integ, 29.999, 30.001);
+    expect_rng("output at min", zone.pid.out, 0, 0);
+}
+
+
+int main(void) {
+    if (!set_base_save())
+        return EXIT_FAILURE;
+
+    unit_parser();
+    unit_curve();
+    unit_zone();
+    unit_pid();
+
+    set_free();
+
+    if (fails) {
+        printf("FAILED\n");
+        return EXIT_FAILURE;
+    }
+    printf("PASSED\n");
+    return EXIT_SUCCESS;
+}